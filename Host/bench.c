@@ -0,0 +1,601 @@
+/* ******************************************
+ 	 * File: bench.c
+ 	 * Description: Primitive level benchmark of SSD1351GL on the simulated bus.
+ 	 *	For every workload reports the bus traffic of the drawing calls and of the
+ 	 *	following Display_Upd, host CPU time per call and the projected bus time
+ 	 *	at the given SPI clock. With the software SPI transport it also reports
+ 	 *	the clock the bit-banged bus reaches on this host.
+ 	 *
+ 	 *	Usage: bench [spi clock, Hz] [timing iterations] [hw | sw | capture]
+ 	 * Author: A_131
+ *******************************************/
+
+#define _POSIX_C_SOURCE 199309L	/* clock_gettime */
+
+#include "SSD1351GL.h"
+#include "hostBus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_SPI_HZ		21000000UL	/* SPI1 at APB2 84 MHz / 4 */
+#define BENCH_DEFAULT_ITERATIONS	50
+
+#define BENCH_BUS_HW		0	/* Transport of the configuration on the simulated SPI unit */
+#define BENCH_BUS_SW		1	/* Display_SwSpiTransport, CLK and DATA decoded by the bus */
+#define BENCH_BUS_CAPTURE	2	/* Host_CaptureTransport */
+
+static struct SSD1351 display;
+static struct SSD1351_Emu emu;
+
+static uint32_t seed;
+static uint8_t bus;
+
+/*
+ * @brief Benchmark workload
+ */
+struct Bench_Case
+{
+	const char *name;
+	void (*run)(struct SSD1351 *display);
+	uint16_t calls;		/* Library calls made by one run */
+};
+
+/*
+ * @brief Results of one workload
+ */
+struct Bench_Result
+{
+	struct Host_BusStats draw;	/* Traffic of the drawing calls */
+	struct Host_BusStats flush;	/* Traffic of the Display_Upd that follows */
+	double drawUs;			/* Host CPU time per call */
+	double flushUs;			/* Host CPU time per Display_Upd */
+};
+
+#if defined(DISPLAY_USE_DMA)
+void DMA2_Stream3_IRQHandler(void)
+{
+	Display_DmaIrqHandler(&display);
+}
+#endif
+
+static const uint8_t icon16[] =	/* 16x16 XBM, LSB first */
+{
+	0xE0, 0x07, 0x18, 0x18, 0x04, 0x20, 0x02, 0x40, 0x32, 0x4C, 0x31, 0x8C, 0x01, 0x80, 0x01, 0x80,
+	0x01, 0x80, 0x09, 0x90, 0x11, 0x88, 0xE2, 0x47, 0x02, 0x40, 0x04, 0x20, 0x18, 0x18, 0xE0, 0x07
+};
+
+static const uint8_t battery16[67] =	/* 16x16 RGB565 icon packed by imgPack, 512 bytes unpacked */
+{
+	0x10, 0x10, 0x3F, 0x00, 0xD5, 0x0B, 0x80, 0x01, 0xB1, 0x40, 0x06, 0x20, 0x06, 0x80, 0x01, 0xB1,
+	0x80, 0x01, 0xB1, 0xB5, 0x06, 0x80, 0x01, 0xB1, 0x00, 0x80, 0x00, 0xB1, 0xB5, 0x06, 0x80, 0x01,
+	0xB1, 0x00, 0x80, 0x00, 0xB1, 0xB5, 0x06, 0x80, 0x01, 0xB1, 0x00, 0x80, 0x00, 0xB1, 0xB5, 0x06,
+	0x80, 0x01, 0xB1, 0x00, 0x80, 0x00, 0xB1, 0xB5, 0x06, 0x80, 0x01, 0xB1, 0x80, 0x01, 0xB1, 0x0B,
+	0x80, 0x3F, 0x00
+};
+
+static uint8_t image32[32 * 32 * 2];	/* RGB565 gradient, MSB first, filled by main */
+static uint16_t splash[DISPLAY_WIDTH * DISPLAY_HEIGHT];	/* Boot screen of the splash workload, filled by main */
+
+
+static uint8_t Bench_Random( uint8_t limit )
+{
+	seed = seed * 1103515245UL + 12345UL;
+
+	return (uint8_t)((seed >> 16) % limit);
+}
+
+
+static void Bench_Flush( struct SSD1351 * d )
+{
+#if DISPLAY_HAS_UPD
+	Display_Upd(d);
+	Display_WaitUpd(d);
+#else
+	(void)d;
+#endif
+}
+
+
+static void Bench_Init( struct SSD1351 * d )		{ Display_Init(d); }
+static void Bench_InitSplash( struct SSD1351 * d )	{ d->splash = splash; Display_Init(d); d->splash = NULL; }
+static void Bench_Clear( struct SSD1351 * d )		{ Display_Clear(d); }
+static void Bench_Fill( struct SSD1351 * d )		{ Display_Fill(d, COLOR_BLUE); }
+
+static void Bench_Pixels( struct SSD1351 * d )
+{
+	uint16_t i;
+
+	for(i = 0; i < 1000; i++)
+	{
+		Display_DrawPixel(d, Bench_Random(DISPLAY_WIDTH), Bench_Random(DISPLAY_HEIGHT), COLOR_YELLOW);
+	}
+}
+
+static void Bench_Lines( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	Display_SetDrawColor(d, COLOR_GREEN);
+
+	for(i = 0; i < 100; i++)
+	{
+		Display_DrawLine(d, Bench_Random(DISPLAY_WIDTH), Bench_Random(DISPLAY_HEIGHT), Bench_Random(DISPLAY_WIDTH), Bench_Random(DISPLAY_HEIGHT));
+	}
+}
+
+static void Bench_HLines( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	Display_SetDrawColor(d, COLOR_CYAN);
+
+	for(i = 0; i < 100; i++)
+	{
+		Display_DrawLine(d, 0, i, DISPLAY_WIDTH - 1, i);
+	}
+}
+
+static void Bench_Boxes( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	for(i = 0; i < 20; i++)
+	{
+		Display_SetDrawColor(d, i & 1 ? COLOR_RED : COLOR_MAGENTA);
+		Display_DrawBox(d, Bench_Random(96), Bench_Random(96), 32, 32);
+	}
+}
+
+static void Bench_BlendBoxes( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	Display_SetDrawMode(d, DISPLAY_DRAW_MODE_BLEND);
+	Display_SetAlpha(d, 96);
+
+	for(i = 0; i < 20; i++)
+	{
+		Display_SetDrawColor(d, i & 1 ? COLOR_RED : COLOR_MAGENTA);
+		Display_DrawBox(d, Bench_Random(96), Bench_Random(96), 32, 32);
+	}
+
+	Display_SetDrawMode(d, DISPLAY_DEFAULT_DRAW_MODE);
+}
+
+static void Bench_Chart( struct SSD1351 * d )
+{
+	uint8_t points[2 * DISPLAY_WIDTH];
+	uint8_t i, k;
+
+	for(k = 0; k < 4; k++)
+	{
+		for(i = 0; i < DISPLAY_WIDTH; i++)
+		{
+			points[2 * i] = i;
+			points[2 * i + 1] = 16 + 32 * k + Bench_Random(32) - 16;
+		}
+
+		Display_SetDrawColor(d, k & 1 ? COLOR_CYAN : COLOR_YELLOW);
+		Display_DrawPolyline(d, points, DISPLAY_WIDTH);
+	}
+}
+
+static void Bench_ThickLines( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	Display_SetDrawColor(d, COLOR_MAGENTA);
+
+	for(i = 0; i < 20; i++)
+	{
+		Display_DrawThickLine(d, Bench_Random(DISPLAY_WIDTH), Bench_Random(DISPLAY_HEIGHT), Bench_Random(DISPLAY_WIDTH), Bench_Random(DISPLAY_HEIGHT), 5);
+	}
+}
+
+static void Bench_LinesAA( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	Display_SetDrawColor(d, COLOR_GREEN);
+
+	for(i = 0; i < 100; i++)
+	{
+		Display_DrawLineAA(d, Bench_Random(DISPLAY_WIDTH), Bench_Random(DISPLAY_HEIGHT), Bench_Random(DISPLAY_WIDTH), Bench_Random(DISPLAY_HEIGHT));
+	}
+}
+
+static void Bench_FullBox( struct SSD1351 * d )
+{
+	Display_SetDrawColor(d, COLOR_BROWN);
+	Display_DrawBox(d, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+}
+
+static void Bench_Frames( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	Display_SetDrawColor(d, COLOR_WHITE);
+
+	for(i = 0; i < 20; i++)
+	{
+		Display_DrawFrame(d, Bench_Random(96), Bench_Random(96), 32, 32);
+	}
+}
+
+static void Bench_Discs( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	for(i = 0; i < 20; i++)
+	{
+		Display_SetDrawColor(d, i & 1 ? COLOR_YELLOW : COLOR_BLUE);
+		Display_DrawDisc(d, 16 + Bench_Random(96), 16 + Bench_Random(96), 16);
+	}
+}
+
+static void Bench_Triangles( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	for(i = 0; i < 20; i++)
+	{
+		Display_SetDrawColor(d, i & 1 ? COLOR_GREEN : COLOR_RED);
+		Display_DrawFilledTriangle(d, Bench_Random(DISPLAY_WIDTH), Bench_Random(DISPLAY_HEIGHT), Bench_Random(DISPLAY_WIDTH), Bench_Random(DISPLAY_HEIGHT), Bench_Random(DISPLAY_WIDTH), Bench_Random(DISPLAY_HEIGHT));
+	}
+}
+
+static void Bench_Chars( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	for(i = 0; i < 100; i++)
+	{
+		Display_DrawAsciiChar(d, Bench_Random(DISPLAY_WIDTH - DISPLAY_FONT_WIDTH), Bench_Random(DISPLAY_HEIGHT - DISPLAY_FONT_HEIGHT), 'A' + i % 26);
+	}
+}
+
+static void Bench_Text( struct SSD1351 * d )
+{
+	uint8_t row;
+
+	Display_SetDrawColor(d, COLOR_WHITE);
+
+	for(row = 0; row < 14; row++)	/* Whole screen of text */
+	{
+		Display_SetCursor(d, 0, row * (DISPLAY_FONT_HEIGHT + 1));
+		Display_PrintString(d, "The quick brown fox j");
+	}
+}
+
+static void Bench_Numbers( struct SSD1351 * d )
+{
+	uint8_t row;
+
+	for(row = 0; row < 14; row++)
+	{
+		Display_SetCursor(d, 0, row * (DISPLAY_FONT_HEIGHT + 1));
+		Display_PrintNum(d, -1234567 * (row + 1));
+	}
+}
+
+static void Bench_Printf( struct SSD1351 * d )
+{
+	uint8_t row;
+
+	for(row = 0; row < 14; row++)
+	{
+		Display_SetCursor(d, 0, row * (DISPLAY_FONT_HEIGHT + 1));
+		Display_Printf(d, "%2u:%+6ld %04X %5.2f", row, -1234567L * (row + 1), row * 0x1111u, row * 1.25);
+	}
+}
+
+static void Bench_Icons( struct SSD1351 * d )
+{
+	uint8_t x, y;
+
+	Display_SetDrawColor(d, COLOR_YELLOW);
+
+	for(y = 0; y < DISPLAY_HEIGHT; y += 16)
+	{
+		for(x = 0; x < DISPLAY_WIDTH; x += 16)
+		{
+			Display_DrawXBM(d, x, y, 16, 16, (uint8_t *)icon16);
+		}
+	}
+}
+
+static void Bench_PackedIcons( struct SSD1351 * d )
+{
+	uint8_t x, y;
+
+	for(y = 0; y < DISPLAY_HEIGHT; y += 16)
+	{
+		for(x = 0; x < DISPLAY_WIDTH; x += 16)
+		{
+			Display_DrawPackedIMG(d, x, y, battery16);
+		}
+	}
+}
+
+static void Bench_Images( struct SSD1351 * d )
+{
+	uint8_t x, y;
+
+	for(y = 0; y < DISPLAY_HEIGHT; y += 32)
+	{
+		for(x = 0; x < DISPLAY_WIDTH; x += 32)
+		{
+			Display_DrawIMG(d, x, y, 32, 32, image32);
+		}
+	}
+}
+
+static void Bench_Sprites( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	for(i = 0; i < 64; i++)	/* 16x16 sprites out of the 32x32 sheet, black is transparent */
+	{
+		Display_DrawIMGPartKey(d, Bench_Random(DISPLAY_WIDTH - 16), Bench_Random(DISPLAY_HEIGHT - 16), image32, 32,
+				(i & 1) * 16, (i & 2) * 8, 16, 16, COLOR_BLACK);
+	}
+}
+
+#if defined(DISPLAY_USE_SPRITES)
+static void Bench_SpriteLayer( struct SSD1351 * d )
+{
+	uint8_t sprites[4], i, frame;
+
+	for(i = 0; i < DISPLAY_SPRITES; i++)
+	{
+		Display_SpriteRemove(d, i);
+	}
+
+	for(i = 0; i < 4; i++)	/* 32x32 gradients, black is transparent */
+	{
+		sprites[i] = Display_SpriteAdd(d, 8 + 64 * (i & 1), 8 + 32 * (i >> 1), 32, 32, image32, DISPLAY_SPRITE_IMG_KEY, COLOR_BLACK);
+	}
+
+	Display_SpritesUpd(d);
+
+	for(frame = 0; frame < 10; frame++)	/* Each sprite moves 2 pixels per frame */
+	{
+		for(i = 0; i < 4; i++)
+		{
+			Display_SpriteMove(d, sprites[i], d->sprites[sprites[i]].x + (i & 1 ? -2 : 2), d->sprites[sprites[i]].y + 2);
+		}
+
+		Display_SpritesUpd(d);
+	}
+}
+#endif
+
+#if defined(DISPLAY_USE_CONSOLE)
+static void Bench_Console( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	for(i = 0; i < 20; i++)	/* Log terminal: update after every line, scrolls after the first 14 */
+	{
+		Display_ConsolePrint(d, "log: sensor ok\t42\n");
+		Bench_Flush(d);
+	}
+}
+#endif
+
+static const struct Bench_Case cases[] =
+{
+	{ "Display_Init",		Bench_Init,	1 },
+	{ "Display_Init splash",	Bench_InitSplash, 1 },
+	{ "Display_Clear",		Bench_Clear,	1 },
+	{ "Display_Fill",		Bench_Fill,	1 },
+	{ "DrawPixel x1000",		Bench_Pixels,	1000 },
+	{ "DrawLine random x100",	Bench_Lines,	100 },
+	{ "DrawLine horizontal x100",	Bench_HLines,	100 },
+	{ "DrawPolyline 128 points x4",	Bench_Chart,	4 },
+	{ "DrawThickLine w5 x20",	Bench_ThickLines, 20 },
+	{ "DrawBox 32x32 x20",		Bench_Boxes,	20 },
+	{ "DrawBox 32x32 blended x20",	Bench_BlendBoxes, 20 },
+	{ "DrawLineAA random x100",	Bench_LinesAA,	100 },
+	{ "DrawBox full screen",	Bench_FullBox,	1 },
+	{ "DrawFrame 32x32 x20",	Bench_Frames,	20 },
+	{ "DrawDisc r16 x20",		Bench_Discs,	20 },
+	{ "DrawFilledTriangle x20",	Bench_Triangles, 20 },
+	{ "DrawAsciiChar x100",		Bench_Chars,	100 },
+	{ "PrintString screen",		Bench_Text,	14 },
+	{ "PrintNum x14",		Bench_Numbers,	14 },
+	{ "Printf x14",			Bench_Printf,	14 },
+	{ "DrawXBM 16x16 x64",		Bench_Icons,	64 },
+	{ "DrawPackedIMG 16x16 x64",	Bench_PackedIcons, 64 },
+	{ "DrawIMG 32x32 x16",		Bench_Images,	16 },
+	{ "DrawIMGPartKey 16x16 x64",	Bench_Sprites,	64 },
+#if defined(DISPLAY_USE_SPRITES)
+	{ "SpritesUpd 4x 32x32 x10",	Bench_SpriteLayer, 10 },
+#endif
+#if defined(DISPLAY_USE_CONSOLE)
+	{ "ConsolePrint 20 lines",	Bench_Console,	20 },
+#endif
+};
+
+
+static double Bench_Now( void )
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+static void Bench_Attach( void )
+{
+	if(bus == BENCH_BUS_SW)
+	{
+		Host_BusAttachPins(&emu, display.clkPinPort, display.clkPin, display.dataPinPort, display.dataPin,
+				display.csPinPort, display.csPin, display.dcPinPort, display.dcPin, display.resPinPort, display.resPin);
+		return;
+	}
+
+	Host_BusAttach(&emu, bus == BENCH_BUS_CAPTURE ? NULL : display.spi,
+			display.csPinPort, display.csPin, display.dcPinPort, display.dcPin, display.resPinPort, display.resPin);
+}
+
+
+/*
+ *	@brief	Run one workload: traffic on the emulated bus first, then CPU time with the emulator detached
+ */
+static void Bench_Run( const struct Bench_Case * c, uint32_t iterations, struct Bench_Result * result )
+{
+	double start, drawTime = 0, flushTime = 0;
+	uint32_t i;
+
+	Bench_Attach();
+	Display_Init(&display);
+	Bench_Flush(&display);
+
+	seed = 1;
+	Host_BusResetStats();
+	c->run(&display);
+	Host_BusGetStats(&result->draw);
+
+	Host_BusResetStats();
+	Bench_Flush(&display);
+	Host_BusGetStats(&result->flush);
+
+	Host_BusDetachAll();
+
+	for(i = 0; i < iterations; i++)
+	{
+		seed = 1;
+
+		start = Bench_Now();
+		c->run(&display);
+		drawTime += Bench_Now() - start;
+
+		start = Bench_Now();
+		Bench_Flush(&display);
+		flushTime += Bench_Now() - start;
+	}
+
+	result->drawUs = drawTime / iterations / c->calls;
+	result->flushUs = flushTime / iterations;
+}
+
+
+static void Bench_PrintRow( const char * name, const struct Host_BusStats * s, double us, double spiHz )
+{
+	uint32_t bytes = s->commandBytes + s->dataBytes;
+
+	printf("  %-26s %8u %9u %7u %7u %10.2f %10.3f\n", name, s->commandBytes, s->dataBytes, s->transactions, s->csToggles,
+			us, bytes * 8.0 / spiHz * 1e3);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct Bench_Result result;
+	double spiHz = argc > 1 ? atof(argv[1]) : BENCH_DEFAULT_SPI_HZ;
+	uint32_t iterations = argc > 2 ? (uint32_t)atoi(argv[2]) : BENCH_DEFAULT_ITERATIONS;
+	const char *busName = argc > 3 ? argv[3] : "hw";
+	double cpuUs, totalBits = 0, totalUs = 0, totalBsrr = 0;
+	uint32_t bytes;
+	uint16_t color;
+	size_t i;
+
+	if(strcmp(busName, "sw") == 0) bus = BENCH_BUS_SW;
+	else if(strcmp(busName, "capture") == 0) bus = BENCH_BUS_CAPTURE;
+	else if(strcmp(busName, "hw") != 0) iterations = 0;
+
+#if !defined(DISPLAY_USE_SW_4SPI)
+	if(bus == BENCH_BUS_SW)
+	{
+		fprintf(stderr, "%s: build with DEFS=-DDISPLAY_USE_SW_4SPI for the software SPI transport\n", argv[0]);
+		return 1;
+	}
+#endif
+
+	if(spiHz <= 0 || iterations == 0)
+	{
+		fprintf(stderr, "usage: %s [spi clock, Hz] [timing iterations] [hw | sw | capture]\n", argv[0]);
+		return 1;
+	}
+
+	display.csPinPort = GPIOA;	display.csPin = 4;
+	display.dcPinPort = GPIOA;	display.dcPin = 3;
+	display.resPinPort = GPIOA;	display.resPin = 2;
+	display.clkPinPort = GPIOA;	display.clkPin = 5;
+	display.dataPinPort = GPIOA;	display.dataPin = 7;
+	display.spi = SPI1;
+
+#if defined(DISPLAY_USE_SW_4SPI)
+	if(bus == BENCH_BUS_SW) display.transport = &Display_SwSpiTransport;
+#endif
+	if(bus == BENCH_BUS_CAPTURE) display.transport = &Host_CaptureTransport;
+
+#if defined(DISPLAY_USE_DMA)
+	display.dma = DMA2;
+	display.dmaStream = DMA2_Stream3;
+	display.dmaStreamNum = 3;
+	display.dmaChannel = 3;
+#endif
+
+	for(i = 0; i < 32 * 32; i++)
+	{
+		color = (i % 32 + i / 32) % 8 ? (uint16_t)((i % 32) << 11 | (i / 32) << 6 | 0x0F) : COLOR_BLACK;	/* Gradient with transparent stripes */
+
+		image32[i * 2] = color >> 8;
+		image32[i * 2 + 1] = color & 0xFF;
+	}
+
+	for(i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT; i++)
+	{
+		splash[i] = (uint16_t)((i / DISPLAY_WIDTH / 4) << 11 | (i % DISPLAY_WIDTH / 2) << 5 | 0x10);	/* Red down, green across */
+	}
+
+	printf("SSD1351GL benchmark, %s transport, SPI clock %.2f MHz, %u timing iterations\n\n", busName, spiHz / 1e6, iterations);
+	printf("  %-26s %8s %9s %7s %7s %10s %10s\n", "workload", "cmd B", "data B", "trans", "CS", "us/call", "bus ms");
+
+	for(i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		Bench_Run(&cases[i], iterations, &result);
+
+		printf("%s (%u calls)\n", cases[i].name, cases[i].calls);
+		Bench_PrintRow("drawing calls", &result.draw, result.drawUs, spiHz);
+		Bench_PrintRow("Display_Upd", &result.flush, result.flushUs, spiHz);
+
+		bytes = result.draw.commandBytes + result.draw.dataBytes + result.flush.commandBytes + result.flush.dataBytes;
+
+		cpuUs = result.drawUs * cases[i].calls + result.flushUs;
+
+		printf("  projected frame: %u bytes, %.3f ms bus + %.3f ms cpu", bytes, bytes * 8.0 / spiHz * 1e3, cpuUs / 1e3);
+
+		if(result.draw.delayMs + result.flush.delayMs)	/* Display_Init: reset pulse and setup delays, time to the first frame */
+		{
+			printf(" + %u ms delays", result.draw.delayMs + result.flush.delayMs);
+		}
+
+		printf("\n");
+
+		if(bus == BENCH_BUS_SW && bytes)	/* The CPU time is the bit-banged bus time */
+		{
+			printf("  bit-banged: %.2f MHz, %.2f BSRR writes per bit\n", bytes * 8.0 / cpuUs,
+					(double)(result.draw.bsrrWrites + result.flush.bsrrWrites) / (bytes * 8.0));
+
+			totalBits += bytes * 8.0;
+			totalUs += cpuUs;
+			totalBsrr += result.draw.bsrrWrites + result.flush.bsrrWrites;
+		}
+	}
+
+	if(totalUs > 0)
+	{
+		printf("\nbit-banged SPI on this host: %.2f MHz over all workloads, %.2f BSRR writes per bit\n",
+				totalBits / totalUs, totalBsrr / totalBits);
+	}
+
+	return 0;
+}
@@ -0,0 +1,557 @@
+/* ******************************************
+ 	 * File: check.c
+ 	 * Description: Pixel exact check of SSD1351GL against the SSD1351 model.
+ 	 *	Every case draws on a freshly initialized display and sends the frame. The panel
+ 	 *	image decoded by the model must match the RGB565 frame buffer (when the build has
+ 	 *	one) and the golden hash of the case. Colors and images are picked from the default
+ 	 *	palette, so the golden image is the same in every configuration.
+ 	 *
+ 	 *	Usage: check [-g]	(-g prints the hashes of this build as a new golden table)
+ 	 * Author: A_131
+ *******************************************/
+
+#include "SSD1351GL.h"
+#include "hostBus.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if DISPLAY_INDEXED
+#define CHECK_COLOR(name)	COLOR_INDEX_##name	/* Colors passed to the library */
+#define CHECK_PIXEL(index)	(uint16_t)(index)	/* Image pixels */
+#else
+#define CHECK_COLOR(name)	COLOR_##name
+#define CHECK_PIXEL(index)	palette[index]
+#endif
+
+#define CHECK_KEY	CHECK_PIXEL(7)	/* Transparent color of the keyed images */
+#define CHECK_PI	3.14159265358979323846
+
+static struct SSD1351 display;
+static struct SSD1351_Emu emu;
+
+/*
+ * @brief Check case
+ */
+struct Check_Case
+{
+	const char *name;
+	void (*run)(struct SSD1351 *display);
+	uint64_t golden;	/* FNV-1a hash of the panel image */
+};
+
+#if defined(DISPLAY_USE_DMA)
+void DMA2_Stream3_IRQHandler(void)
+{
+	Display_DmaIrqHandler(&display);
+}
+#endif
+
+#if !DISPLAY_INDEXED
+static const uint16_t palette[] =	/* Default palette: COLOR_INDEX_BLACK..COLOR_INDEX_WHITE */
+{
+	COLOR_BLACK, COLOR_RED, COLOR_GREEN, COLOR_BLUE, COLOR_YELLOW, COLOR_CYAN, COLOR_MAGENTA, COLOR_BROWN, COLOR_WHITE
+};
+#endif
+
+static const uint16_t colors[] =	/* Draw colors picked at random */
+{
+	CHECK_COLOR(RED), CHECK_COLOR(GREEN), CHECK_COLOR(BLUE), CHECK_COLOR(YELLOW), CHECK_COLOR(CYAN), CHECK_COLOR(MAGENTA)
+};
+
+static const uint8_t icon16[] =	/* 16x16 XBM, LSB first */
+{
+	0xE0, 0x07, 0x18, 0x18, 0x04, 0x20, 0x02, 0x40, 0x32, 0x4C, 0x31, 0x8C, 0x01, 0x80, 0x01, 0x80,
+	0x01, 0x80, 0x09, 0x90, 0x11, 0x88, 0xE2, 0x47, 0x02, 0x40, 0x04, 0x20, 0x18, 0x18, 0xE0, 0x07
+};
+
+static uint8_t image[40 * 30 * 2];	/* RGB565 images, MSB first, filled by main */
+static uint8_t sheet[64 * 32 * 2];
+static uint8_t packed[DISPLAY_PACK_HEADER + 24 * 20 * 3];
+
+static uint32_t seed;
+
+
+static uint8_t Check_Random( uint8_t limit )
+{
+	seed = seed * 1103515245UL + 12345UL;
+
+	return (uint8_t)((seed >> 16) % limit);
+}
+
+
+static void Check_Flush( struct SSD1351 * d )
+{
+#if DISPLAY_HAS_UPD
+	Display_Upd(d);
+	Display_WaitUpd(d);
+#else
+	(void)d;
+#endif
+}
+
+
+static void Check_Pixels( struct SSD1351 * d )
+{
+	uint16_t i;
+
+	Display_DrawPixel(d, 0, 0, CHECK_COLOR(RED));
+	Display_DrawPixel(d, DISPLAY_WIDTH - 1, 0, CHECK_COLOR(GREEN));
+	Display_DrawPixel(d, 0, DISPLAY_HEIGHT - 1, CHECK_COLOR(BLUE));
+	Display_DrawPixel(d, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1, CHECK_COLOR(WHITE));
+
+	for(i = 0; i < 300; i++)
+	{
+		Display_DrawPixel(d, Check_Random(DISPLAY_WIDTH), Check_Random(DISPLAY_HEIGHT), colors[Check_Random(4)]);
+	}
+}
+
+
+static void Check_Lines( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	Display_SetDrawColor(d, CHECK_COLOR(GREEN));
+	Display_DrawLine(d, 0, 0, 127, 127);
+	Display_DrawLine(d, 127, 0, 0, 127);
+	Display_DrawLine(d, 5, 60, 120, 60);	/* Horizontal, vertical, both directions */
+	Display_DrawLine(d, 120, 64, 5, 64);
+	Display_DrawLine(d, 70, 3, 70, 125);
+	Display_DrawLine(d, 74, 125, 74, 3);
+
+	Display_SetDrawColor(d, CHECK_COLOR(CYAN));
+
+	for(i = 0; i < 20; i++)
+	{
+		Display_DrawLine(d, Check_Random(DISPLAY_WIDTH), Check_Random(DISPLAY_HEIGHT), Check_Random(DISPLAY_WIDTH), Check_Random(DISPLAY_HEIGHT));
+	}
+}
+
+
+static void Check_Polylines( struct SSD1351 * d )
+{
+	static const uint8_t points[] = { 2, 100, 20, 40, 40, 90, 60, 10, 80, 120, 100, 50, 125, 70 };
+
+	Display_SetDrawColor(d, CHECK_COLOR(YELLOW));
+	Display_DrawPolyline(d, points, sizeof(points) / 2);
+
+	Display_SetDrawColor(d, CHECK_COLOR(MAGENTA));
+	Display_DrawThickLine(d, 10, 10, 110, 30, 5);
+	Display_DrawThickLine(d, 20, 120, 30, 50, 4);
+	Display_DrawThickLine(d, 120, 100, 120, 100, 3);
+}
+
+
+static void Check_Rectangles( struct SSD1351 * d )
+{
+	Display_SetDrawColor(d, CHECK_COLOR(RED));
+	Display_DrawBox(d, 3, 5, 17, 9);
+	Display_DrawBox(d, 120, 120, 20, 20);	/* Cut at the screen edge */
+	Display_DrawBox(d, 60, 60, 1, 1);
+
+	Display_SetDrawColor(d, CHECK_COLOR(CYAN));
+	Display_DrawFrame(d, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+	Display_DrawFrame(d, 31, 41, 20, 11);
+	Display_DrawFrame(d, 100, 10, 2, 2);
+
+	Display_SetDrawColor(d, CHECK_COLOR(BROWN));
+	Display_DrawRBox(d, 10, 70, 50, 30, 8);
+	Display_DrawRFrame(d, 70, 70, 50, 40, 12);
+}
+
+
+static void Check_Ellipses( struct SSD1351 * d )
+{
+	Display_SetDrawColor(d, CHECK_COLOR(WHITE));
+	Display_DrawCircle(d, 30, 30, 20);
+	Display_DrawCircle(d, 2, 64, 10);	/* Cut at the screen edge */
+	Display_DrawDisc(d, 90, 30, 16);
+
+	Display_SetDrawColor(d, CHECK_COLOR(BLUE));
+	Display_DrawEllipse(d, 40, 95, 30, 12);
+	Display_DrawFilledEllipse(d, 100, 100, 20, 27);
+}
+
+
+static void Check_Polygons( struct SSD1351 * d )
+{
+	static const uint8_t star[] = { 64, 5, 76, 45, 120, 45, 84, 70, 98, 115, 64, 88, 30, 115, 44, 70, 8, 45, 52, 45 };
+
+	Display_SetDrawColor(d, CHECK_COLOR(GREEN));
+	Display_DrawFilledPolygon(d, star, sizeof(star) / 2);
+
+	Display_SetDrawColor(d, CHECK_COLOR(RED));
+	Display_DrawPolygon(d, star, sizeof(star) / 2);
+	Display_DrawTriangle(d, 2, 2, 40, 10, 10, 38);
+	Display_DrawFilledTriangle(d, 126, 2, 90, 20, 120, 40);
+}
+
+
+static void Check_Text( struct SSD1351 * d )
+{
+	Display_SetDrawColor(d, CHECK_COLOR(WHITE));
+	Display_SetCursor(d, 3, 0);
+	Display_PrintString(d, "Hello 123");
+	Display_SetCursor(d, 0, 10);
+	Display_PrintNum(d, -2147483647);
+	Display_SetCursor(d, 0, 20);
+	Display_Printf(d, "%5d|%-4x|%08.3f|%s", 42, 0xBEEF, -3.14159, "ok");
+	Display_DrawAsciiChar(d, 120, 120, 'Z');	/* Cut at the screen edge */
+
+	Display_SetBackColor(d, CHECK_COLOR(BLUE));
+	Display_SetCursor(d, 0, 40);
+	Display_PrintString(d, "override");
+
+	Display_SetDrawMode(d, DISPLAY_DRAW_MODE_COMPOSE);
+	Display_SetDrawColor(d, CHECK_COLOR(YELLOW));
+	Display_SetCursor(d, 1, 42);
+	Display_PrintString(d, "compose");
+	Display_SetDrawMode(d, DISPLAY_DRAW_MODE_OVERRIDE);
+}
+
+
+static void Check_Bitmaps( struct SSD1351 * d )
+{
+	Display_SetDrawColor(d, CHECK_COLOR(YELLOW));
+	Display_DrawXBM(d, 77, 90, 16, 16, (uint8_t *)icon16);
+
+	Display_SetDrawMode(d, DISPLAY_DRAW_MODE_COMPOSE);
+	Display_DrawXBM(d, 120, 5, 16, 16, (uint8_t *)icon16);
+	Display_SetDrawMode(d, DISPLAY_DRAW_MODE_OVERRIDE);
+
+	Display_DrawPackedIMG(d, 5, 100, packed);
+	Display_DrawPackedIMG(d, 115, 60, packed);
+}
+
+
+static void Check_Images( struct SSD1351 * d )
+{
+	Display_DrawIMG(d, 3, 7, 40, 30, image);
+	Display_DrawIMG(d, 100, 110, 40, 30, image);	/* Cut at the screen edge */
+	Display_DrawIMGKey(d, 20, 20, 40, 30, image, CHECK_KEY);
+	Display_DrawIMGPart(d, 61, 50, sheet, 64, 13, 5, 17, 11);
+	Display_DrawIMGPartKey(d, 1, 80, sheet, 64, 50, 20, 30, 12, CHECK_KEY);
+	Display_DrawIMGPartKey(d, 115, 80, sheet, 64, 0, 0, 30, 12, CHECK_KEY);
+}
+
+
+static void Check_Viewport( struct SSD1351 * d )
+{
+	Display_Fill(d, CHECK_COLOR(BROWN));
+
+	Display_SetViewport(d, 64, 10, 50, 40);
+	Display_SetDrawColor(d, CHECK_COLOR(RED));
+	Display_DrawBox(d, 0, 0, 200, 200);
+	Display_SetDrawColor(d, CHECK_COLOR(WHITE));
+	Display_DrawLine(d, 0, 0, 200, 30);
+	Display_DrawCircle(d, 25, 20, 30);
+	Display_SetCursor(d, 2, 30);
+	Display_PrintString(d, "clipped text");
+	Display_DrawIMG(d, 30, 25, 40, 30, image);
+
+	Display_ResetClip(d);
+	Display_SetOrigin(d, 0, 0);
+	Display_SetDrawColor(d, CHECK_COLOR(GREEN));
+	Display_DrawFrame(d, 63, 9, 52, 42);
+}
+
+
+static void Check_Updates( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	for(i = 0; i < 6; i++)	/* Several partial updates on top of each other */
+	{
+		Display_SetDrawColor(d, colors[i]);
+		Display_DrawBox(d, Check_Random(100), Check_Random(100), 4 + Check_Random(30), 4 + Check_Random(30));
+		Display_DrawPixel(d, Check_Random(DISPLAY_WIDTH), Check_Random(DISPLAY_HEIGHT), CHECK_COLOR(WHITE));
+		Check_Flush(d);
+	}
+
+	Display_Fill(d, CHECK_COLOR(BLUE));
+	Display_SetDrawColor(d, CHECK_COLOR(YELLOW));
+	Display_DrawBox(d, 0, 120, DISPLAY_WIDTH, 8);
+}
+
+
+static void Check_LongPaths( struct SSD1351 * d )
+{
+	static uint8_t points[2 * 255];
+	uint16_t i;
+
+	for(i = 0; i < 200; i++)	/* Chart over more points than the display list text holds */
+	{
+		points[2 * i] = i * (DISPLAY_WIDTH - 1) / 199;
+		points[2 * i + 1] = 20 + (i % 40 < 20 ? i % 20 : 20 - i % 20) * 2 + Check_Random(8);
+	}
+
+	Display_SetDrawColor(d, CHECK_COLOR(YELLOW));
+	Display_DrawPolyline(d, points, 200);
+
+	for(i = 0; i < 150; i++)	/* Convex polygons with more than 128 corners */
+	{
+		points[2 * i] = (uint8_t)lround(40 + 30 * cos(i * 2 * CHECK_PI / 150));
+		points[2 * i + 1] = (uint8_t)lround(90 + 30 * sin(i * 2 * CHECK_PI / 150));
+	}
+
+	Display_SetDrawColor(d, CHECK_COLOR(GREEN));
+	Display_DrawFilledPolygon(d, points, 150);
+
+	for(i = 0; i < 140; i++)
+	{
+		points[2 * i] = (uint8_t)lround(95 + 25 * cos(i * 2 * CHECK_PI / 140));
+		points[2 * i + 1] = (uint8_t)lround(95 + 25 * sin(i * 2 * CHECK_PI / 140));
+	}
+
+	Display_SetDrawColor(d, CHECK_COLOR(RED));
+	Display_SetBackColor(d, CHECK_COLOR(BLUE));
+	Display_DrawPolygon(d, points, 140);
+
+	Display_SetDrawColor(d, CHECK_COLOR(WHITE));	/* Recorded after them */
+	Display_DrawLine(d, 0, 127, 127, 60);
+}
+
+
+static void Check_StartLine( struct SSD1351 * d )
+{
+	Display_SetDrawColor(d, CHECK_COLOR(GREEN));
+	Display_DrawBox(d, 0, 0, 60, 20);
+	Check_Flush(d);
+
+	Display_ScrollV(d, 37);		/* Screen rows 91..127 are RAM rows 0..36 now */
+
+	Display_SetDrawColor(d, CHECK_COLOR(RED));
+	Display_DrawBox(d, 10, 80, 50, 30);	/* Crosses the RAM wrap */
+	Display_DrawLine(d, 0, 127, 127, 0);
+	Display_DrawCircle(d, 90, 90, 25);
+	Display_SetCursor(d, 0, 88);
+	Display_PrintString(d, "wrapped text");
+	Display_DrawIMG(d, 80, 85, 40, 30, image);
+	Check_Flush(d);
+
+	Display_ScrollV(d, -50);
+	Display_SetDrawColor(d, CHECK_COLOR(CYAN));
+	Display_DrawBox(d, 70, 0, 20, DISPLAY_HEIGHT);
+
+	Display_SetOffset(d, 5);
+	Display_SetDrawColor(d, CHECK_COLOR(MAGENTA));
+	Display_DrawFrame(d, 2, 2, 124, 124);
+}
+
+
+#if defined(DISPLAY_USE_CONSOLE)
+static void Check_Console( struct SSD1351 * d )
+{
+	uint8_t i;
+
+	for(i = 0; i < 20; i++)	/* Scrolls the start line after 14 lines */
+	{
+		Display_ConsolePrint(d, "log:\tline ");
+		Display_ConsolePutChar(d, 'a' + i);
+		Display_ConsolePrint(d, "\n");
+		Check_Flush(d);
+	}
+}
+#endif
+
+
+#if defined(DISPLAY_USE_SPRITES)
+static void Check_Sprites( struct SSD1351 * d )
+{
+	uint8_t ball, tile;
+
+	Display_Fill(d, CHECK_COLOR(BLUE));
+	Check_Flush(d);
+
+	ball = Display_SpriteAdd(d, 10, 10, 16, 16, icon16, DISPLAY_SPRITE_XBM, CHECK_COLOR(YELLOW));
+	tile = Display_SpriteAdd(d, 50, 60, 40, 30, image, DISPLAY_SPRITE_IMG_KEY, CHECK_KEY);
+	Display_SpritesUpd(d);
+
+	Display_SpriteMove(d, ball, 60, 70);
+	Display_SpriteMove(d, tile, -10, 110);
+	Display_SpritesUpd(d);
+}
+#endif
+
+
+static const struct Check_Case cases[] =
+{
+	{ "pixels",		Check_Pixels,		0x9A748E6D4E3944F0ULL },
+	{ "lines",		Check_Lines,		0xA8A74F66845D38F2ULL },
+	{ "polylines",		Check_Polylines,	0x7F67557A57A843D3ULL },
+	{ "rectangles",		Check_Rectangles,	0xF59602915FB4B569ULL },
+	{ "ellipses",		Check_Ellipses,		0xD111413D9F10D854ULL },
+	{ "polygons",		Check_Polygons,		0xE24A20FFABE0CB83ULL },
+	{ "text",		Check_Text,		0xD1D5B57C496ADC24ULL },
+	{ "bitmaps",		Check_Bitmaps,		0xB13D494C34E3D636ULL },
+	{ "images",		Check_Images,		0x7EF1B2DAEBB2CECBULL },
+	{ "viewport",		Check_Viewport,		0xE0DE2DDEDB920783ULL },
+	{ "updates",		Check_Updates,		0x0A791CE05EA31F83ULL },
+	{ "long paths",		Check_LongPaths,	0x380FEE1B9876C96FULL },
+	{ "start line",		Check_StartLine,	0xCAB541CEA8594F27ULL },
+#if defined(DISPLAY_USE_CONSOLE)
+	{ "console",		Check_Console,		0x388C24576FF41305ULL },
+#endif
+#if defined(DISPLAY_USE_SPRITES)
+	{ "sprites",		Check_Sprites,		0x88B30C648838470AULL },
+#endif
+};
+
+
+/*
+ *	@brief	Compare the panel image with the RGB565 frame buffer
+ *
+ *	@retval	Pixels that differ, 0 without such a buffer
+ */
+static uint32_t Check_FrameBuffer( const struct SSD1351 * d )
+{
+	uint32_t bad = 0;
+#if DISPLAY_HAS_BLEND
+	const uint16_t *frame = (const uint16_t *)d->frameBuffer;
+	uint8_t x, y;
+
+	for(y = 0; y < DISPLAY_HEIGHT; y++)
+	{
+		for(x = 0; x < DISPLAY_WIDTH; x++)
+		{
+			if(Emu_GetPixel(&emu, x, y) != frame[y * DISPLAY_WIDTH + x]) bad++;
+		}
+	}
+#else
+	(void)d;
+#endif
+
+	return bad;
+}
+
+
+static uint64_t Check_Hash( void )
+{
+	uint64_t hash = 1469598103934665603ULL;
+	uint8_t x, y;
+
+	for(y = 0; y < DISPLAY_HEIGHT; y++)
+	{
+		for(x = 0; x < DISPLAY_WIDTH; x++)
+		{
+			hash ^= Emu_GetPixel(&emu, x, y);
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	return hash;
+}
+
+
+/*
+ *	@brief	Pack an image with literal ops only, the decoder sees the same pixels as Display_DrawIMG
+ */
+static void Check_Pack( uint8_t * out, uint8_t width, uint8_t height )
+{
+	uint16_t i, n, pixels = width * height;
+	uint16_t color;
+
+	*out++ = width;
+	*out++ = height;
+
+	for(i = 0; i < pixels; i += n)
+	{
+		n = pixels - i < 64 ? pixels - i : 64;
+
+		*out++ = DISPLAY_PACK_LITERAL | (n - 1);
+
+		for(color = 0; color < n; color++)
+		{
+			*out++ = image[(i + color) * 2];
+			*out++ = image[(i + color) * 2 + 1];
+		}
+	}
+}
+
+
+int main(int argc, char *argv[])
+{
+	uint8_t golden = argc > 1 && strcmp(argv[1], "-g") == 0;
+	uint32_t bad, failed = 0;
+	uint64_t hash;
+	uint16_t color;
+	size_t i;
+
+	display.csPinPort = GPIOA;	display.csPin = 4;
+	display.dcPinPort = GPIOA;	display.dcPin = 3;
+	display.resPinPort = GPIOA;	display.resPin = 2;
+	display.clkPinPort = GPIOA;	display.clkPin = 5;
+	display.dataPinPort = GPIOA;	display.dataPin = 7;
+	display.spi = SPI1;
+
+#if defined(DISPLAY_USE_SW_4SPI)
+	display.transport = &Display_SwSpiTransport;	/* Bit-banged bytes must decode the same */
+#endif
+
+#if defined(DISPLAY_USE_DMA)
+	display.dma = DMA2;
+	display.dmaStream = DMA2_Stream3;
+	display.dmaStreamNum = 3;
+	display.dmaChannel = 3;
+#endif
+
+	seed = 5;
+
+	for(i = 0; i < sizeof(image) / 2; i++)
+	{
+		color = Check_Random(5) ? CHECK_PIXEL(Check_Random(9)) : CHECK_KEY;
+
+		image[i * 2] = color >> 8;
+		image[i * 2 + 1] = color & 0xFF;
+	}
+
+	for(i = 0; i < sizeof(sheet) / 2; i++)
+	{
+		color = Check_Random(4) ? CHECK_PIXEL(Check_Random(9)) : CHECK_KEY;
+
+		sheet[i * 2] = color >> 8;
+		sheet[i * 2 + 1] = color & 0xFF;
+	}
+
+	Check_Pack(packed, 24, 20);
+
+#if defined(DISPLAY_USE_SW_4SPI)
+	Host_BusAttachPins(&emu, display.clkPinPort, display.clkPin, display.dataPinPort, display.dataPin,
+			display.csPinPort, display.csPin, display.dcPinPort, display.dcPin, display.resPinPort, display.resPin);
+#else
+	Host_BusAttach(&emu, display.spi, display.csPinPort, display.csPin, display.dcPinPort, display.dcPin,
+			display.resPinPort, display.resPin);
+#endif
+
+	for(i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		seed = 1;
+
+		Display_Init(&display);
+		cases[i].run(&display);
+		Check_Flush(&display);
+
+		bad = Check_FrameBuffer(&display);
+		hash = Check_Hash();
+
+		if(golden)
+		{
+			printf("%-12s 0x%016llXULL\n", cases[i].name, (unsigned long long)hash);
+			continue;
+		}
+
+		if(bad || hash != cases[i].golden || emu.unknown)
+		{
+			printf("FAIL %-12s %u pixels differ from the frame buffer, hash %016llX (golden %016llX), %u unknown commands\n",
+					cases[i].name, bad, (unsigned long long)hash, (unsigned long long)cases[i].golden, emu.unknown);
+			failed++;
+		}
+		else
+		{
+			printf("ok   %s\n", cases[i].name);
+		}
+	}
+
+	return failed != 0;
+}
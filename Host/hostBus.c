@@ -0,0 +1,576 @@
+/* ******************************************
+ 	 * File: hostBus.c
+ 	 * Description: lib2f4 stand-in, simulated SPI bus and capture transport of the host build
+ 	 * Author: A_131
+ *******************************************/
+
+#define _POSIX_C_SOURCE 199309L	/* clock_gettime */
+
+#include "hostBus.h"
+
+#include <string.h>
+#include <time.h>
+
+GPIO_TypeDef hostGpio[5];
+SPI_TypeDef hostSpi[3] = { { .SR = SPI_SR_TXE }, { .SR = SPI_SR_TXE }, { .SR = SPI_SR_TXE } };	/* Transmitter always ready */
+RCC_TypeDef hostRcc;
+DMA_TypeDef hostDma[2];
+DMA_Stream_TypeDef hostDmaStream[2][8];
+
+/*
+ * @brief Display attached to the bus
+ */
+struct Host_Device
+{
+	struct SSD1351_Emu *emu;
+	SPI_TypeDef *spi;	/* NULL - listens to the CLK and DATA pins */
+
+	GPIO_TypeDef *csPort;
+	GPIO_TypeDef *dcPort;
+	GPIO_TypeDef *resPort;
+	GPIO_TypeDef *clkPort;
+	GPIO_TypeDef *dataPort;
+
+	uint8_t csPin;
+	uint8_t dcPin;
+	uint8_t resPin;
+	uint8_t clkPin;
+	uint8_t dataPin;
+
+	uint8_t shift;		/* Bits sampled on the CLK rising edges so far */
+	uint8_t bits;
+};
+
+static struct Host_Device devices[HOST_BUS_DEVICES];
+static uint8_t deviceCount;
+
+static struct Host_BusStats stats;
+
+/* DMA stream interrupt handlers, the application overrides the ones it uses */
+
+#define HOST_DMA_IRQ(unit, num) \
+	void DMA##unit##_Stream##num##_IRQHandler(void) __attribute__((weak)); \
+	void DMA##unit##_Stream##num##_IRQHandler(void) {}
+
+HOST_DMA_IRQ(1, 0) HOST_DMA_IRQ(1, 1) HOST_DMA_IRQ(1, 2) HOST_DMA_IRQ(1, 3)
+HOST_DMA_IRQ(1, 4) HOST_DMA_IRQ(1, 5) HOST_DMA_IRQ(1, 6) HOST_DMA_IRQ(1, 7)
+HOST_DMA_IRQ(2, 0) HOST_DMA_IRQ(2, 1) HOST_DMA_IRQ(2, 2) HOST_DMA_IRQ(2, 3)
+HOST_DMA_IRQ(2, 4) HOST_DMA_IRQ(2, 5) HOST_DMA_IRQ(2, 6) HOST_DMA_IRQ(2, 7)
+
+static void (* const dmaIrqHandlers[2][8])(void) =
+{
+	{ DMA1_Stream0_IRQHandler, DMA1_Stream1_IRQHandler, DMA1_Stream2_IRQHandler, DMA1_Stream3_IRQHandler,
+	  DMA1_Stream4_IRQHandler, DMA1_Stream5_IRQHandler, DMA1_Stream6_IRQHandler, DMA1_Stream7_IRQHandler },
+	{ DMA2_Stream0_IRQHandler, DMA2_Stream1_IRQHandler, DMA2_Stream2_IRQHandler, DMA2_Stream3_IRQHandler,
+	  DMA2_Stream4_IRQHandler, DMA2_Stream5_IRQHandler, DMA2_Stream6_IRQHandler, DMA2_Stream7_IRQHandler }
+};
+
+static const uint8_t dmaFlagOffset[4] = { 0, 6, 16, 22 };
+
+#define HOST_DMA_TCIF	(uint32_t)0x20
+
+
+/*
+ *	@brief	Attach a display emulator to the bus
+ *
+ *	@param	Emulator that receives the bytes
+ *	@param	SPI unit the display listens to
+ *	@param	CS port and pin
+ *	@param	DC port and pin
+ *	@param	RES port and pin
+ *
+ *	@retval none
+ */
+void Host_BusAttach(struct SSD1351_Emu *emu, SPI_TypeDef *spi,
+		GPIO_TypeDef *csPort, uint8_t csPin, GPIO_TypeDef *dcPort, uint8_t dcPin, GPIO_TypeDef *resPort, uint8_t resPin)
+{
+	struct Host_Device *device;
+
+	if(deviceCount >= HOST_BUS_DEVICES) return;
+
+	device = &devices[deviceCount++];
+
+	device->emu = emu;
+	device->spi = spi;
+	device->csPort = csPort;
+	device->csPin = csPin;
+	device->dcPort = dcPort;
+	device->dcPin = dcPin;
+	device->resPort = resPort;
+	device->resPin = resPin;
+	device->clkPort = NULL;
+	device->bits = 0;
+
+	Emu_Reset(emu);
+}
+
+
+/*
+ *	@brief	Attach a display emulator driven by bit-banged SPI
+ *		DATA is sampled on the rising edges of CLK while CS is low, most significant bit first
+ *
+ *	@param	Emulator that receives the bytes
+ *	@param	CLK port and pin
+ *	@param	DATA port and pin
+ *	@param	CS port and pin
+ *	@param	DC port and pin
+ *	@param	RES port and pin
+ *
+ *	@retval none
+ */
+void Host_BusAttachPins(struct SSD1351_Emu *emu, GPIO_TypeDef *clkPort, uint8_t clkPin, GPIO_TypeDef *dataPort, uint8_t dataPin,
+		GPIO_TypeDef *csPort, uint8_t csPin, GPIO_TypeDef *dcPort, uint8_t dcPin, GPIO_TypeDef *resPort, uint8_t resPin)
+{
+	struct Host_Device *device;
+
+	if(deviceCount >= HOST_BUS_DEVICES) return;
+
+	Host_BusAttach(emu, NULL, csPort, csPin, dcPort, dcPin, resPort, resPin);
+
+	device = &devices[deviceCount - 1];
+
+	device->clkPort = clkPort;
+	device->clkPin = clkPin;
+	device->dataPort = dataPort;
+	device->dataPin = dataPin;
+}
+
+
+/*
+ *	@brief	Remove all displays from the bus
+ *
+ *	@retval none
+ */
+void Host_BusDetachAll(void)
+{
+	deviceCount = 0;
+}
+
+
+/*
+ *	@brief	Copy the traffic counters
+ *
+ *	@param	Destination
+ *
+ *	@retval none
+ */
+void Host_BusGetStats(struct Host_BusStats *out)
+{
+	*out = stats;
+}
+
+
+/*
+ *	@brief	Reset the traffic counters
+ *
+ *	@retval none
+ */
+void Host_BusResetStats(void)
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+
+/*
+ *	@brief	Deliver one byte to a display, its DC pin tells command from data
+ *
+ *	@param	Display
+ *	@param	Byte
+ *	@param	0 - the byte is already counted
+ *
+ *	@retval none
+ */
+static void Host_DeviceByte( struct Host_Device * device, uint8_t value, uint8_t count )
+{
+	uint8_t dc = GPIO_GetPin(device->dcPort, device->dcPin);
+
+	if(count)
+	{
+		if(dc) stats.dataBytes++; else stats.commandBytes++;
+	}
+
+	Emu_Write(device->emu, dc, value);
+}
+
+
+/*
+ *	@brief	Deliver one byte to every display selected on the SPI unit
+ *
+ *	@param	SPI unit
+ *	@param	Byte
+ *
+ *	@retval none
+ */
+static void Host_BusByte( SPI_TypeDef * spi, uint8_t value )
+{
+	struct Host_Device *device;
+	uint8_t i;
+	uint8_t counted = 0;
+
+	for(i = 0; i < deviceCount; i++)
+	{
+		device = &devices[i];
+
+		if(device->spi != spi || GPIO_GetPin(device->csPort, device->csPin)) continue;
+
+		Host_DeviceByte(device, value, !counted);
+		counted = 1;
+	}
+}
+
+
+/*
+ *	@brief	Sample DATA of the bit-banged displays that see a rising edge of their CLK pin
+ *
+ *	@param	Port of the pin that went high
+ *	@param	Pin
+ *
+ *	@retval none
+ */
+static void Host_BusClock( GPIO_TypeDef * port, uint8_t pin )
+{
+	struct Host_Device *device;
+	uint8_t i;
+	uint8_t counted = 0;
+
+	for(i = 0; i < deviceCount; i++)
+	{
+		device = &devices[i];
+
+		if(device->clkPort != port || device->clkPin != pin || GPIO_GetPin(device->csPort, device->csPin)) continue;
+
+		device->shift = (uint8_t)(device->shift << 1) | GPIO_GetPin(device->dataPort, device->dataPin);
+
+		if(++device->bits < 8) continue;
+
+		device->bits = 0;
+
+		if(!counted) stats.frames++;
+
+		Host_DeviceByte(device, device->shift, !counted);
+		counted = 1;
+	}
+}
+
+
+/*
+ *	@brief	Write to the SPI data register
+ *
+ *	@param	SPI unit
+ *	@param	Frame, 16 bit wide when SPI_CR1_DFF is set
+ *
+ *	@retval none
+ */
+void SPI_HostWrite(SPI_TypeDef *spi, uint16_t value)
+{
+	stats.frames++;
+
+	spi->DR = value;
+
+	if(spi->CR1 & SPI_CR1_DFF)
+	{
+		Host_BusByte(spi, value >> 8);	/* MSB first */
+	}
+
+	Host_BusByte(spi, value & 0xFF);
+}
+
+
+/*
+ *	@brief	Find the SPI unit whose data register is at the address
+ *
+ *	@param	Peripheral address of a DMA stream
+ *
+ *	@retval	SPI unit or NULL
+ */
+static SPI_TypeDef * Host_SpiFromAddress( uintptr_t address )
+{
+	uint8_t i;
+
+	for(i = 0; i < 3; i++)
+	{
+		if(address == (uintptr_t)&hostSpi[i].DR) return &hostSpi[i];
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	@brief	Run the simulated DMA
+ *		Completes the first enabled memory-to-SPI stream whose request is active,
+ *		sets its transfer complete flag and calls its interrupt handler.
+ *		Waiting for an interrupt (__WFI) lands here.
+ *
+ *	@retval none
+ */
+void Host_DmaService(void)
+{
+	DMA_Stream_TypeDef *stream;
+	SPI_TypeDef *spi;
+	const uint8_t *src;
+	uint32_t i, count, step;
+	uint16_t value;
+	uint8_t unit, num;
+
+	for(unit = 0; unit < 2; unit++)
+	{
+		for(num = 0; num < 8; num++)
+		{
+			stream = &hostDmaStream[unit][num];
+
+			if(!(stream->CR & DMA_SxCR_EN)) continue;
+
+			spi = Host_SpiFromAddress(stream->PAR);
+
+			if(spi == NULL || !(spi->CR2 & SPI_CR2_TXDMAEN)) continue;	/* No request yet */
+
+			src = (const uint8_t *)stream->M0AR;
+			count = stream->NDTR;
+			step = (stream->CR & DMA_SxCR_MINC) ? ((stream->CR & DMA_SxCR_MSIZE_0) ? 2 : 1) : 0;
+
+			for(i = 0; i < count; i++, src += step)
+			{
+				if(stream->CR & DMA_SxCR_MSIZE_0)
+				{
+					memcpy(&value, src, sizeof(value));
+				}
+				else
+				{
+					value = *src;
+				}
+
+				SPI_HostWrite(spi, value);
+			}
+
+			stream->NDTR = 0;
+			stream->CR &= ~DMA_SxCR_EN;
+
+			if(num < 4)
+			{
+				hostDma[unit].LISR |= HOST_DMA_TCIF << dmaFlagOffset[num];
+			}
+			else
+			{
+				hostDma[unit].HISR |= HOST_DMA_TCIF << dmaFlagOffset[num - 4];
+			}
+
+			stats.dmaTransfers++;
+
+			if(stream->CR & DMA_SxCR_TCIE) dmaIrqHandlers[unit][num]();
+
+			return;	/* One interrupt per wait */
+		}
+	}
+}
+
+
+/* lib2f4 API */
+
+void GPIO_InitPin(GPIO_TypeDef *port, uint8_t pin, uint32_t mode)
+{
+	port->MODER = (port->MODER & ~(3UL << (pin * 2))) | ((mode & 3UL) << (pin * 2));
+}
+
+
+void GPIO_SetAltMode(GPIO_TypeDef *port, uint8_t pin, uint8_t af)
+{
+	port->AFR[pin >> 3] = (port->AFR[pin >> 3] & ~(0xFUL << ((pin & 7) * 4))) | ((uint32_t)(af & 0xF) << ((pin & 7) * 4));
+}
+
+
+uint8_t GPIO_GetPin(GPIO_TypeDef *port, uint8_t pin)
+{
+	return (port->ODR >> pin) & 1;
+}
+
+
+/*
+ *	@brief	Drive an output pin, CS/DC/RES edges of attached displays are counted and RES resets the emulator
+ */
+void GPIO_SetPin(GPIO_TypeDef *port, uint8_t pin, uint8_t state)
+{
+	uint8_t i;
+	uint8_t cs = 0, dc = 0;
+
+	state = state ? 1 : 0;
+
+	if(GPIO_GetPin(port, pin) == state) return;
+
+	if(state)
+	{
+		port->ODR |= 1UL << pin;
+	}
+	else
+	{
+		port->ODR &= ~(1UL << pin);
+	}
+
+	for(i = 0; i < deviceCount; i++)
+	{
+		if(devices[i].csPort == port && devices[i].csPin == pin)
+		{
+			cs = 1;
+			devices[i].bits = 0;	/* A byte cut short by CS is dropped */
+		}
+
+		if(devices[i].dcPort == port && devices[i].dcPin == pin) dc = 1;
+		if(devices[i].resPort == port && devices[i].resPin == pin && !state) Emu_Reset(devices[i].emu);
+	}
+
+	if(state) Host_BusClock(port, pin);
+
+	if(cs)
+	{
+		stats.csToggles++;
+		if(!state) stats.transactions++;
+	}
+
+	if(dc) stats.dcToggles++;
+}
+
+
+/*
+ *	@brief	Write to the bit set/reset register of a port
+ *		Pins in the low half are set, the other pins in the high half are reset.
+ *		Only pins that change level go through GPIO_SetPin, resets first
+ */
+void GPIO_HostBsrr(GPIO_TypeDef *port, uint32_t value)
+{
+	uint32_t set = value & 0xFFFF;
+	uint32_t reset = (value >> 16) & ~set & port->ODR;	/* Set wins when a pin is in both halves */
+
+	stats.bsrrWrites++;
+
+	set &= ~port->ODR;
+
+	for(; reset; reset &= reset - 1)
+	{
+		GPIO_SetPin(port, (uint8_t)__builtin_ctz(reset), 0);
+	}
+
+	for(; set; set &= set - 1)
+	{
+		GPIO_SetPin(port, (uint8_t)__builtin_ctz(set), 1);
+	}
+}
+
+
+void SPI_TransmitByte(SPI_TypeDef *spi, uint8_t data)
+{
+	SPI_HostWrite(spi, data);
+}
+
+
+/* Capture transport: the library calls land here without a simulated SPI unit */
+
+/*
+ *	@brief	Deliver one byte to the displays attached with the CS pin of the display
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	0 - command, 1 - data
+ *	@param	Byte
+ *
+ *	@retval none
+ */
+static void Host_CaptureByte( struct SSD1351 * display, uint8_t dataMode, uint8_t value )
+{
+	struct Host_Device *device;
+	uint8_t i;
+	uint8_t counted = 0;
+
+	GPIO_SetPin(display->dcPinPort, display->dcPin, dataMode);
+
+	for(i = 0; i < deviceCount; i++)
+	{
+		device = &devices[i];
+
+		if(device->csPort != display->csPinPort || device->csPin != display->csPin || GPIO_GetPin(device->csPort, device->csPin)) continue;
+
+		Host_DeviceByte(device, value, !counted);
+		counted = 1;
+	}
+}
+
+
+static void Host_CaptureBegin( struct SSD1351 * display )
+{
+	GPIO_SetPin(display->csPinPort, display->csPin, 0);
+}
+
+
+static void Host_CaptureEnd( struct SSD1351 * display )
+{
+	GPIO_SetPin(display->csPinPort, display->csPin, 1);
+}
+
+
+static void Host_CaptureCommand( struct SSD1351 * display, uint8_t command, const uint8_t * data, uint16_t length )
+{
+	stats.frames += 1 + length;
+
+	Host_CaptureByte(display, 0, command);
+
+	while(length--)
+	{
+		Host_CaptureByte(display, 1, *data++);
+	}
+}
+
+
+static void Host_CaptureWrite( struct SSD1351 * display, const uint8_t * data, uint32_t length )
+{
+	stats.frames += length;
+
+	while(length--)
+	{
+		Host_CaptureByte(display, 1, *data++);
+	}
+}
+
+
+static void Host_CaptureWritePixels( struct SSD1351 * display, const uint16_t * pixels, uint32_t count )
+{
+	stats.frames += count;
+
+	for(; count; count--, pixels++)
+	{
+		Host_CaptureByte(display, 1, *pixels >> 8);
+		Host_CaptureByte(display, 1, *pixels & 0xFF);
+	}
+}
+
+
+static void Host_CaptureWriteRepeat( struct SSD1351 * display, uint16_t color, uint32_t count )
+{
+	stats.frames += count;
+
+	while(count--)
+	{
+		Host_CaptureByte(display, 1, color >> 8);
+		Host_CaptureByte(display, 1, color & 0xFF);
+	}
+}
+
+
+const struct Display_Transport Host_CaptureTransport =
+{
+	NULL, Host_CaptureBegin, Host_CaptureEnd, Host_CaptureCommand,
+	Host_CaptureWrite, Host_CaptureWritePixels, Host_CaptureWriteRepeat, NULL
+};
+
+
+uint32_t Host_CycleCount(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+
+void _delay_ms(uint32_t ms)
+{
+	stats.delayMs += ms;
+}
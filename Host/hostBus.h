@@ -0,0 +1,53 @@
+/* ******************************************
+ 	 * File: hostBus.h
+ 	 * Description: Simulated SPI bus of the host build.
+ 	 *	Connects SPI units, bit-banged CLK/DATA pins and CS/DC/RES pins of the
+ 	 *	lib2f4 stand-in to SSD1351 emulators and counts the traffic.
+ 	 *	Host_CaptureTransport hands the bytes of the library straight to them
+ 	 * Author: A_131
+ *******************************************/
+
+#ifndef HOST_BUS_H
+#define HOST_BUS_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "SSD1351GL.h"
+#include "ssd1351Emu.h"
+
+#define HOST_BUS_DEVICES 4	/* Displays that can be attached at once */
+
+/*
+ * @brief Bus traffic counters
+ */
+struct Host_BusStats
+{
+	uint32_t commandBytes;	/* Bytes sent with DC = 0 */
+	uint32_t dataBytes;	/* Bytes sent with DC = 1 */
+	uint32_t frames;	/* Data register writes (8 or 16 bit), bit-banged bytes, capture transport words */
+	uint32_t transactions;	/* CS assertions */
+	uint32_t csToggles;	/* CS edges */
+	uint32_t dcToggles;	/* DC edges */
+	uint32_t dmaTransfers;	/* Completed DMA stream transfers */
+	uint32_t bsrrWrites;	/* GPIO BSRR writes (bit-banged SPI) */
+	uint32_t delayMs;	/* Time requested through _delay_ms */
+};
+
+void Host_BusAttach(struct SSD1351_Emu *emu, SPI_TypeDef *spi,
+		GPIO_TypeDef *csPort, uint8_t csPin, GPIO_TypeDef *dcPort, uint8_t dcPin, GPIO_TypeDef *resPort, uint8_t resPin);
+void Host_BusAttachPins(struct SSD1351_Emu *emu, GPIO_TypeDef *clkPort, uint8_t clkPin, GPIO_TypeDef *dataPort, uint8_t dataPin,
+		GPIO_TypeDef *csPort, uint8_t csPin, GPIO_TypeDef *dcPort, uint8_t dcPin, GPIO_TypeDef *resPort, uint8_t resPin);
+void Host_BusDetachAll(void);
+
+void Host_BusGetStats(struct Host_BusStats *stats);
+void Host_BusResetStats(void);
+
+extern const struct Display_Transport Host_CaptureTransport;	/* No SPI unit, bytes go to the displays attached with the CS pin of the display */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* HOST_BUS_H */
@@ -0,0 +1,206 @@
+/* ******************************************
+ 	 * File: imgPack.c
+ 	 * Description: Offline encoder of packed RGB565 images for Display_DrawPackedIMG.
+ 	 *	Reads a binary PPM (P6, maxval 255), writes the packed image as a C array.
+ 	 *	The format is described next to DISPLAY_PACK_RUN in SSD1351GL.h
+ 	 *
+ 	 *	Usage: imgPack <image.ppm> <array name> > image.h
+ 	 * Author: A_131
+ *******************************************/
+
+#include "SSD1351GL.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PACK_MAX_SIDE	255	/* Width and height are stored in one byte */
+
+/*
+ * @brief Encoder output and state, mirrors struct Display_Unpack of the decoder
+ */
+struct Pack_State
+{
+	uint8_t *out;
+	size_t length;
+	long literalOp;		/* Position of the open literal op, -1 when there is none */
+	uint16_t color;
+	uint8_t run;
+	uint16_t recent[DISPLAY_PACK_RECENT];
+};
+
+
+/*
+ *	@brief	Skip whitespace and comments of a PPM header and read a number
+ *
+ *	@retval	Number, -1 on error
+ */
+static long Pack_ReadNumber( FILE * file )
+{
+	long value = 0;
+	int c;
+
+	do
+	{
+		c = fgetc(file);
+
+		if(c == '#')
+		{
+			while(c != '\n' && c != EOF) c = fgetc(file);
+		}
+	}
+	while(c == ' ' || c == '\t' || c == '\r' || c == '\n');
+
+	if(c < '0' || c > '9') return -1;
+
+	while(c >= '0' && c <= '9')
+	{
+		value = value * 10 + (c - '0');
+		c = fgetc(file);
+	}
+
+	return value;	/* The single whitespace after maxval is consumed here */
+}
+
+
+static void Pack_Byte( struct Pack_State * state, uint8_t value )
+{
+	state->out[state->length++] = value;
+}
+
+
+static void Pack_FlushRun( struct Pack_State * state )
+{
+	if(state->run == 0) return;
+
+	Pack_Byte(state, DISPLAY_PACK_RUN | (state->run - 1));
+
+	state->run = 0;
+	state->literalOp = -1;
+}
+
+
+/*
+ *	@brief	Encode one pixel: run, recent color, small difference or literal, whichever is shortest
+ */
+static void Pack_Pixel( struct Pack_State * state, uint16_t color )
+{
+	uint8_t dr, dg, db;
+	uint8_t hash = DISPLAY_PACK_HASH(color);
+
+	if(color == state->color)
+	{
+		if(++state->run == 64) Pack_FlushRun(state);
+		return;
+	}
+
+	Pack_FlushRun(state);
+
+	dr = ((color >> 11) - (state->color >> 11) + 2) & 0x1F;
+	dg = ((color >> 5) - (state->color >> 5) + 2) & 0x3F;
+	db = ((color & 0x1F) - (state->color & 0x1F) + 2) & 0x1F;
+
+	if(state->recent[hash] == color)
+	{
+		Pack_Byte(state, DISPLAY_PACK_INDEX | hash);
+		state->literalOp = -1;
+	}
+	else if(dr < 4 && dg < 4 && db < 4)
+	{
+		Pack_Byte(state, DISPLAY_PACK_DIFF | (dr << 4) | (dg << 2) | db);
+		state->literalOp = -1;
+	}
+	else
+	{
+		if(state->literalOp < 0 || (state->out[state->literalOp] & 0x3F) == 0x3F)
+		{
+			state->literalOp = (long)state->length;
+			Pack_Byte(state, DISPLAY_PACK_LITERAL);
+		}
+		else
+		{
+			state->out[state->literalOp]++;
+		}
+
+		Pack_Byte(state, color >> 8);
+		Pack_Byte(state, color & 0xFF);
+	}
+
+	state->recent[hash] = color;
+	state->color = color;
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct Pack_State state = { 0 };
+	FILE *file;
+	long width, height, maxval;
+	uint8_t rgb[3];
+	uint16_t color;
+	size_t i, pixels;
+
+	if(argc != 3)
+	{
+		fprintf(stderr, "usage: %s <image.ppm> <array name>\n", argv[0]);
+		return 1;
+	}
+
+	file = fopen(argv[1], "rb");
+
+	if(file == NULL || fgetc(file) != 'P' || fgetc(file) != '6')
+	{
+		fprintf(stderr, "%s: not a binary PPM (P6)\n", argv[1]);
+		return 1;
+	}
+
+	width = Pack_ReadNumber(file);
+	height = Pack_ReadNumber(file);
+	maxval = Pack_ReadNumber(file);
+
+	if(width < 1 || height < 1 || width > PACK_MAX_SIDE || height > PACK_MAX_SIDE || maxval != 255)
+	{
+		fprintf(stderr, "%s: need 1..%d x 1..%d pixels with maxval 255\n", argv[1], PACK_MAX_SIDE, PACK_MAX_SIDE);
+		return 1;
+	}
+
+	pixels = (size_t)width * height;
+	state.out = malloc(DISPLAY_PACK_HEADER + pixels * 3);	/* Worst case: a literal op per 64 pixels, 2 bytes each */
+	state.literalOp = -1;
+
+	if(state.out == NULL) return 1;
+
+	Pack_Byte(&state, (uint8_t)width);
+	Pack_Byte(&state, (uint8_t)height);
+
+	for(i = 0; i < pixels; i++)
+	{
+		if(fread(rgb, 1, 3, file) != 3)
+		{
+			fprintf(stderr, "%s: truncated image\n", argv[1]);
+			return 1;
+		}
+
+		color = (uint16_t)(((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 | ((rgb[2] * 31 + 127) / 255));
+
+		Pack_Pixel(&state, color);
+	}
+
+	Pack_FlushRun(&state);
+	fclose(file);
+
+	printf("/* %s: %ldx%ld, %zu bytes packed, %zu bytes RGB565 */\n", argv[1], width, height, state.length, pixels * 2);
+	printf("static const uint8_t %s[%zu] =\n{", argv[2], state.length);
+
+	for(i = 0; i < state.length; i++)
+	{
+		printf("%s0x%02X,", i % 16 ? " " : "\n\t", state.out[i]);
+	}
+
+	printf("\n};\n");
+
+	fprintf(stderr, "%s: %zu -> %zu bytes (%.1f%%)\n", argv[1], pixels * 2, state.length, state.length * 100.0 / (pixels * 2));
+
+	free(state.out);
+
+	return 0;
+}
@@ -0,0 +1,191 @@
+/* ******************************************
+ 	 * File: lib2f4.h
+ 	 * Description: Host (Linux) stand-in for the STM32F4 peripheral library.
+ 	 *	Provides the GPIO, SPI, RCC and DMA definitions used by SSD1351GL,
+ 	 *	the bus behind them is simulated by hostBus.c
+ 	 * Author: A_131
+ *******************************************/
+
+#ifndef LIB2F4_H
+#define LIB2F4_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LIB2F4_HOST 1	/* SSD1351GL routes SPI data register writes to SPI_HostWrite, GPIO BSRR writes to GPIO_HostBsrr */
+
+/* Peripheral register layouts (same field names as CMSIS) */
+
+typedef struct
+{
+	volatile uint32_t MODER;
+	volatile uint32_t OTYPER;
+	volatile uint32_t OSPEEDR;
+	volatile uint32_t PUPDR;
+	volatile uint32_t IDR;
+	volatile uint32_t ODR;
+	volatile uint32_t BSRR;
+	volatile uint32_t LCKR;
+	volatile uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CR1;
+	volatile uint32_t CR2;
+	volatile uint32_t SR;
+	volatile uint32_t DR;
+	volatile uint32_t CRCPR;
+	volatile uint32_t RXCRCR;
+	volatile uint32_t TXCRCR;
+	volatile uint32_t I2SCFGR;
+	volatile uint32_t I2SPR;
+} SPI_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t AHB1ENR;
+	volatile uint32_t APB1ENR;
+	volatile uint32_t APB2ENR;
+} RCC_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CR;
+	volatile uint32_t NDTR;
+	volatile uintptr_t PAR;		/* Addresses are pointer sized on the host */
+	volatile uintptr_t M0AR;
+	volatile uintptr_t M1AR;
+	volatile uint32_t FCR;
+} DMA_Stream_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t LISR;
+	volatile uint32_t HISR;
+	volatile uint32_t LIFCR;
+	volatile uint32_t HIFCR;
+} DMA_TypeDef;
+
+/* Peripheral instances */
+
+extern GPIO_TypeDef hostGpio[5];
+extern SPI_TypeDef hostSpi[3];
+extern RCC_TypeDef hostRcc;
+extern DMA_TypeDef hostDma[2];
+extern DMA_Stream_TypeDef hostDmaStream[2][8];
+
+#define GPIOA	(&hostGpio[0])
+#define GPIOB	(&hostGpio[1])
+#define GPIOC	(&hostGpio[2])
+#define GPIOD	(&hostGpio[3])
+#define GPIOE	(&hostGpio[4])
+
+#define SPI1	(&hostSpi[0])
+#define SPI2	(&hostSpi[1])
+#define SPI3	(&hostSpi[2])
+
+#define RCC	(&hostRcc)
+
+#define DMA1	(&hostDma[0])
+#define DMA2	(&hostDma[1])
+
+#define DMA1_Stream0	(&hostDmaStream[0][0])
+#define DMA1_Stream1	(&hostDmaStream[0][1])
+#define DMA1_Stream2	(&hostDmaStream[0][2])
+#define DMA1_Stream3	(&hostDmaStream[0][3])
+#define DMA1_Stream4	(&hostDmaStream[0][4])
+#define DMA1_Stream5	(&hostDmaStream[0][5])
+#define DMA1_Stream6	(&hostDmaStream[0][6])
+#define DMA1_Stream7	(&hostDmaStream[0][7])
+#define DMA2_Stream0	(&hostDmaStream[1][0])
+#define DMA2_Stream1	(&hostDmaStream[1][1])
+#define DMA2_Stream2	(&hostDmaStream[1][2])
+#define DMA2_Stream3	(&hostDmaStream[1][3])
+#define DMA2_Stream4	(&hostDmaStream[1][4])
+#define DMA2_Stream5	(&hostDmaStream[1][5])
+#define DMA2_Stream6	(&hostDmaStream[1][6])
+#define DMA2_Stream7	(&hostDmaStream[1][7])
+
+/* Register bits */
+
+#define RCC_AHB1ENR_GPIOAEN	(1UL << 0)
+#define RCC_AHB1ENR_GPIOBEN	(1UL << 1)
+#define RCC_AHB1ENR_GPIOCEN	(1UL << 2)
+#define RCC_AHB1ENR_DMA1EN	(1UL << 21)
+#define RCC_AHB1ENR_DMA2EN	(1UL << 22)
+#define RCC_APB1ENR_SPI2EN	(1UL << 14)
+#define RCC_APB1ENR_SPI3EN	(1UL << 15)
+#define RCC_APB2ENR_SPI1EN	(1UL << 12)
+
+#define SPI_CR1_CPHA	(1UL << 0)
+#define SPI_CR1_CPOL	(1UL << 1)
+#define SPI_CR1_MSTR	(1UL << 2)
+#define SPI_CR1_BR_0	(1UL << 3)
+#define SPI_CR1_BR_1	(1UL << 4)
+#define SPI_CR1_BR_2	(1UL << 5)
+#define SPI_CR1_SPE	(1UL << 6)
+#define SPI_CR1_SSI	(1UL << 8)
+#define SPI_CR1_SSM	(1UL << 9)
+#define SPI_CR1_DFF	(1UL << 11)
+
+#define SPI_CR2_TXDMAEN	(1UL << 1)
+
+#define SPI_SR_TXE	(1UL << 1)
+#define SPI_SR_BSY	(1UL << 7)
+
+#define DMA_SxCR_EN		(1UL << 0)
+#define DMA_SxCR_TCIE		(1UL << 4)
+#define DMA_SxCR_DIR_0		(1UL << 6)
+#define DMA_SxCR_CIRC		(1UL << 8)
+#define DMA_SxCR_PINC		(1UL << 9)
+#define DMA_SxCR_MINC		(1UL << 10)
+#define DMA_SxCR_PSIZE_0	(1UL << 11)
+#define DMA_SxCR_MSIZE_0	(1UL << 13)
+#define DMA_SxCR_CHSEL_Pos	25
+
+#define GPIO_MODE_INPUT		0x00
+#define GPIO_MODE_OUTPUT	0x01
+#define GPIO_MODE_ALT		0x02
+#define GPIO_MODE_ANALOG	0x03
+#define GPIO_OSPEED_50MHZ	0x20
+
+/* Core intrinsics. Waiting for an interrupt runs the simulated DMA until a transfer completes */
+
+void Host_DmaService(void);
+
+#define __WFI()		Host_DmaService()
+#define __enable_irq()	((void)0)
+#define __disable_irq()	((void)0)
+#define __get_PRIMASK()	0UL
+#define __set_PRIMASK(mask)	((void)(mask))
+
+/* Host only: free running counter standing in for DWT->CYCCNT, 1 tick = 1 ns */
+uint32_t Host_CycleCount(void);
+
+/* lib2f4 API */
+
+void GPIO_InitPin(GPIO_TypeDef *port, uint8_t pin, uint32_t mode);
+void GPIO_SetAltMode(GPIO_TypeDef *port, uint8_t pin, uint8_t af);
+void GPIO_SetPin(GPIO_TypeDef *port, uint8_t pin, uint8_t state);
+uint8_t GPIO_GetPin(GPIO_TypeDef *port, uint8_t pin);
+
+void SPI_TransmitByte(SPI_TypeDef *spi, uint8_t data);
+
+void _delay_ms(uint32_t ms);
+
+/* Host only: a write to spi->DR, 8 or 16 bits wide depending on SPI_CR1_DFF */
+void SPI_HostWrite(SPI_TypeDef *spi, uint16_t value);
+
+/* Host only: a write to port->BSRR, low half sets pins, high half resets them */
+void GPIO_HostBsrr(GPIO_TypeDef *port, uint32_t value);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIB2F4_H */
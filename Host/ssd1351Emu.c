@@ -0,0 +1,354 @@
+/* ******************************************
+ 	 * File: ssd1351Emu.c
+ 	 * Description: Software model of the SSD1351 controller
+ 	 * Author: A_131
+ *******************************************/
+
+#include "ssd1351Emu.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define EMU_PARAMS_STREAM	0xFF	/* Command takes data until the next command */
+#define EMU_PARAMS_UNKNOWN	0xFE
+
+#define EMU_REMAP_VERTICAL_INC	0x01	/* 0xA0 bits */
+#define EMU_REMAP_COLUMN	0x02
+#define EMU_REMAP_COLOR_RGB	0x04
+#define EMU_REMAP_COM_SCAN	0x10
+
+/*
+ *	@brief	Number of parameter bytes of a command
+ *
+ *	@param	Command byte
+ *
+ *	@retval	Parameter count, EMU_PARAMS_STREAM or EMU_PARAMS_UNKNOWN
+ */
+static uint8_t Emu_ParamCount( uint8_t command )
+{
+	switch(command)
+	{
+	case 0x5C: case 0x5D:
+		return EMU_PARAMS_STREAM;
+
+	case 0x9E: case 0x9F: case 0xA4: case 0xA5: case 0xA6: case 0xA7:
+	case 0xAE: case 0xAF: case 0xB9:
+		return 0;
+
+	case 0xA0: case 0xA1: case 0xA2: case 0xAB: case 0xB1: case 0xB3:
+	case 0xB5: case 0xB6: case 0xBB: case 0xBE: case 0xC7: case 0xCA:
+	case 0xFD:
+		return 1;
+
+	case 0x15: case 0x75:
+		return 2;
+
+	case 0xB2: case 0xB4: case 0xC1:
+		return 3;
+
+	case 0x96:
+		return 5;
+
+	case 0xB8:
+		return 63;
+
+	default:
+		return EMU_PARAMS_UNKNOWN;
+	}
+}
+
+
+/*
+ *	@brief	Apply a command once all its parameters arrived
+ *
+ *	@param	Ptr to the emulator
+ *
+ *	@retval none
+ */
+static void Emu_Execute( struct SSD1351_Emu * emu )
+{
+	uint8_t *p = emu->params;
+
+	switch(emu->command)
+	{
+	case 0x15:	/* Column window */
+		emu->colStart = p[0] & 0x7F;
+		emu->colEnd = p[1] & 0x7F;
+		emu->col = emu->colStart;
+		emu->windows++;
+		break;
+
+	case 0x75:	/* Row window */
+		emu->rowStart = p[0] & 0x7F;
+		emu->rowEnd = p[1] & 0x7F;
+		emu->row = emu->rowStart;
+		emu->windows++;
+		break;
+
+	case 0x5C:	/* RAM write, pixels follow */
+		emu->pixelPhase = 0;
+		break;
+
+	case 0x96:	/* Horizontal scroll setup */
+		emu->hScrollShift = p[0];
+		emu->hScrollRow = p[1] & 0x7F;
+		emu->hScrollRows = p[2];
+		emu->hScrollSpeed = p[4];
+		break;
+
+	case 0x9E: emu->hScrollActive = 0; break;
+	case 0x9F: emu->hScrollActive = 1; emu->hScrollPos = 0; break;
+
+	case 0xA0: emu->remap = p[0]; break;
+	case 0xA1: emu->startLine = p[0] & 0x7F; break;
+	case 0xA2: emu->offset = p[0] & 0x7F; break;
+
+	case 0xA4: case 0xA5: case 0xA6: case 0xA7:
+		emu->mode = emu->command;
+		break;
+
+	case 0xAE: emu->sleep = 1; break;
+	case 0xAF: emu->sleep = 0; break;
+
+	case 0xFD:
+		if(p[0] == 0x16) emu->locked = 1;
+		if(p[0] == 0x12) emu->locked = 0;
+		break;
+
+	default:	/* Analog settings don't change the image */
+		break;
+	}
+}
+
+
+/*
+ *	@brief	Store one pixel at the RAM pointer and advance it inside the window
+ *
+ *	@param	Ptr to the emulator
+ *	@param	RGB565 color
+ *
+ *	@retval none
+ */
+static void Emu_PutPixel( struct SSD1351_Emu * emu, uint16_t color )
+{
+	emu->gram[emu->row][emu->col] = color;
+	emu->pixels++;
+
+	if(emu->remap & EMU_REMAP_VERTICAL_INC)
+	{
+		if(emu->row++ >= emu->rowEnd)
+		{
+			emu->row = emu->rowStart;
+			emu->col = emu->col >= emu->colEnd ? emu->colStart : emu->col + 1;
+		}
+	}
+	else
+	{
+		if(emu->col++ >= emu->colEnd)
+		{
+			emu->col = emu->colStart;
+			emu->row = emu->row >= emu->rowEnd ? emu->rowStart : emu->row + 1;
+		}
+	}
+}
+
+
+/*
+ *	@brief	Hardware reset (RES pin low)
+ *
+ *	@param	Ptr to the emulator
+ *
+ *	@retval none
+ */
+void Emu_Reset(struct SSD1351_Emu *emu)
+{
+	memset(emu, 0, sizeof(*emu));
+
+	emu->colEnd = EMU_WIDTH - 1;
+	emu->rowEnd = EMU_HEIGHT - 1;
+	emu->mode = 0xA6;
+	emu->sleep = 1;
+}
+
+
+/*
+ *	@brief	Feed one byte received on the bus
+ *
+ *	@param	Ptr to the emulator
+ *	@param	DC pin state: 0 - command, 1 - data
+ *	@param	Byte
+ *
+ *	@retval none
+ */
+void Emu_Write(struct SSD1351_Emu *emu, uint8_t dataMode, uint8_t value)
+{
+	uint8_t count;
+
+	if(!dataMode)
+	{
+		emu->commands++;
+
+		if(emu->locked && value != 0xFD) return;	/* Locked controller only listens to unlock */
+
+		emu->command = value;
+		emu->paramCount = 0;
+
+		count = Emu_ParamCount(value);
+
+		if(count == EMU_PARAMS_UNKNOWN)
+		{
+			emu->unknown++;
+		}
+		else if(count == 0 || count == EMU_PARAMS_STREAM)
+		{
+			Emu_Execute(emu);
+		}
+
+		return;
+	}
+
+	emu->dataBytes++;
+
+	if(emu->locked) return;
+
+	count = Emu_ParamCount(emu->command);
+
+	if(count == EMU_PARAMS_STREAM)
+	{
+		if(emu->command != 0x5C) return;	/* RAM read isn't modelled */
+
+		if(emu->pixelPhase == 0)
+		{
+			emu->pixelHigh = value;
+			emu->pixelPhase = 1;
+		}
+		else
+		{
+			Emu_PutPixel(emu, ((uint16_t)emu->pixelHigh << 8) | value);
+			emu->pixelPhase = 0;
+		}
+	}
+	else if(count != EMU_PARAMS_UNKNOWN && emu->paramCount < count)
+	{
+		emu->params[emu->paramCount++] = value;
+
+		if(emu->paramCount == count) Emu_Execute(emu);
+	}
+}
+
+
+/*
+ *	@brief	Advance the horizontal scroll engine
+ *		Shift 0x01..0x3F moves the image towards SEG127, 0x40..0xFF towards SEG0
+ *
+ *	@param	Ptr to the emulator
+ *	@param	Number of scroll steps
+ *
+ *	@retval none
+ */
+void Emu_Tick(struct SSD1351_Emu *emu, uint16_t steps)
+{
+	int16_t shift;
+
+	if(!emu->hScrollActive || emu->hScrollShift == 0) return;
+
+	shift = emu->hScrollShift < 0x40 ? emu->hScrollShift : -(int16_t)((0x100 - emu->hScrollShift) & 0x7F);
+
+	emu->hScrollPos = (uint8_t)(emu->hScrollPos + shift * steps) & (EMU_WIDTH - 1);
+}
+
+
+/*
+ *	@brief	Reset traffic counters
+ *
+ *	@param	Ptr to the emulator
+ *
+ *	@retval none
+ */
+void Emu_ClearCounters(struct SSD1351_Emu *emu)
+{
+	emu->commands = 0;
+	emu->dataBytes = 0;
+	emu->pixels = 0;
+	emu->windows = 0;
+	emu->unknown = 0;
+}
+
+
+/*
+ *	@brief	Get the color of a pixel as shown on the panel
+ *		Remap 0x74 (as set by Display_Init) gives an upright image on the usual modules,
+ *		start line and offset rotate the rows, inverse mode complements the color
+ *
+ *	@param	Ptr to the emulator
+ *	@param	Panel x coordinate
+ *	@param	Panel y coordinate
+ *
+ *	@retval	RGB565 color
+ */
+uint16_t Emu_GetPixel(const struct SSD1351_Emu *emu, uint8_t x, uint8_t y)
+{
+	uint8_t row, col;
+	uint16_t color;
+
+	if(emu->sleep || emu->mode == 0xA4) return 0x0000;
+	if(emu->mode == 0xA5) return 0xFFFF;
+
+	row = (emu->remap & EMU_REMAP_COM_SCAN) ? y : (EMU_HEIGHT - 1 - y);
+	row = (row + emu->startLine + emu->offset) & (EMU_HEIGHT - 1);
+
+	col = (emu->remap & EMU_REMAP_COLUMN) ? (EMU_WIDTH - 1 - x) : x;
+
+	if(emu->hScrollActive && row >= emu->hScrollRow && row < emu->hScrollRow + emu->hScrollRows)
+	{
+		col = (col - emu->hScrollPos) & (EMU_WIDTH - 1);
+	}
+
+	color = emu->gram[row][col];
+
+	if(!(emu->remap & EMU_REMAP_COLOR_RGB))	/* C-B-A order swaps red and blue */
+	{
+		color = (color << 11) | (color & 0x07E0) | (color >> 11);
+	}
+
+	if(emu->mode == 0xA7) color = ~color;
+
+	return color;
+}
+
+
+/*
+ *	@brief	Save the panel image as binary PPM
+ *
+ *	@param	Ptr to the emulator
+ *	@param	File path
+ *
+ *	@retval	0 - ok, -1 - file error
+ */
+int Emu_WritePPM(const struct SSD1351_Emu *emu, const char *path)
+{
+	FILE *file = fopen(path, "wb");
+	uint16_t color;
+	uint8_t rgb[3];
+	uint8_t x, y;
+
+	if(file == NULL) return -1;
+
+	fprintf(file, "P6\n%d %d\n255\n", EMU_WIDTH, EMU_HEIGHT);
+
+	for(y = 0; y < EMU_HEIGHT; y++)
+	{
+		for(x = 0; x < EMU_WIDTH; x++)
+		{
+			color = Emu_GetPixel(emu, x, y);
+
+			rgb[0] = ((color >> 11) & 0x1F) * 255 / 31;
+			rgb[1] = ((color >> 5) & 0x3F) * 255 / 63;
+			rgb[2] = (color & 0x1F) * 255 / 31;
+
+			fwrite(rgb, 1, 3, file);
+		}
+	}
+
+	return fclose(file) == 0 ? 0 : -1;
+}
@@ -0,0 +1,71 @@
+/* ******************************************
+ 	 * File: ssd1351Emu.h
+ 	 * Description: Software model of the SSD1351 controller.
+ 	 *	Decodes the command/data byte stream into a virtual 128x128 GRAM
+ 	 *	and renders the panel image the way the controller would show it
+ 	 * Author: A_131
+ *******************************************/
+
+#ifndef SSD1351_EMU_H
+#define SSD1351_EMU_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define EMU_WIDTH	128
+#define EMU_HEIGHT	128
+
+/*
+ * @brief Controller state
+ */
+struct SSD1351_Emu
+{
+	uint16_t gram[EMU_HEIGHT][EMU_WIDTH];	/* Display RAM, RGB565 as received */
+
+	uint8_t command;		/* Command being decoded */
+	uint8_t params[64];		/* Its parameters (0xB8 has 63) */
+	uint8_t paramCount;
+
+	uint8_t colStart, colEnd;	/* Write window (0x15, 0x75) */
+	uint8_t rowStart, rowEnd;
+	uint8_t col, row;		/* RAM pointer */
+	uint8_t pixelHigh;		/* First byte of a pixel */
+	uint8_t pixelPhase;		/* 1 when pixelHigh is waiting for the second byte */
+
+	uint8_t remap;			/* 0xA0 */
+	uint8_t startLine;		/* 0xA1 */
+	uint8_t offset;			/* 0xA2 */
+	uint8_t mode;			/* 0xA4..0xA7 */
+	uint8_t sleep;			/* 1 after 0xAE */
+	uint8_t locked;			/* 0xFD 0x16 */
+
+	uint8_t hScrollShift;		/* 0x96 parameters */
+	uint8_t hScrollRow;
+	uint8_t hScrollRows;
+	uint8_t hScrollSpeed;
+	uint8_t hScrollActive;		/* 0x9F / 0x9E */
+	uint8_t hScrollPos;		/* Columns scrolled so far */
+
+	uint32_t commands;		/* Traffic decoded by the model */
+	uint32_t dataBytes;
+	uint32_t pixels;
+	uint32_t windows;		/* 0x15 and 0x75 commands */
+	uint32_t unknown;		/* Commands the model doesn't know */
+};
+
+void Emu_Reset(struct SSD1351_Emu *emu);
+void Emu_Write(struct SSD1351_Emu *emu, uint8_t dataMode, uint8_t value);
+void Emu_Tick(struct SSD1351_Emu *emu, uint16_t steps);
+void Emu_ClearCounters(struct SSD1351_Emu *emu);
+
+uint16_t Emu_GetPixel(const struct SSD1351_Emu *emu, uint8_t x, uint8_t y);
+int Emu_WritePPM(const struct SSD1351_Emu *emu, const char *path);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* SSD1351_EMU_H */
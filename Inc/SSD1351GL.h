@@ -21,8 +21,60 @@ extern "C" {
 #include "stdarg.h"		/* include C standard lib */
 #include "stdlib.h"
 
-#define DISPLAY_HAS_BUFFER 1
-#define FRAME_BUFFER_SIZE 128 * 128 * 2
+#if defined(DISPLAY_USE_BANDS)
+	#undef DISPLAY_USE_BUFFER	/* Bands replace the full frame buffer */
+#endif
+
+#if defined(DISPLAY_USE_BUFFER)
+	#define DISPLAY_HAS_BUFFER 1
+#else
+	#define DISPLAY_HAS_BUFFER 0
+#endif
+
+#if DISPLAY_HAS_BUFFER && DISPLAY_BUFFER_BPP != 16
+	#define DISPLAY_INDEXED 1	/* Frame buffer holds palette indices */
+#else
+	#define DISPLAY_INDEXED 0
+#endif
+
+#if DISPLAY_HAS_BUFFER && !DISPLAY_INDEXED
+	#define DISPLAY_HAS_BLEND 1	/* RGB565 frame buffer: pixels can be read back and blended */
+#else
+	#define DISPLAY_HAS_BLEND 0
+#endif
+
+#if DISPLAY_HAS_BUFFER || defined(DISPLAY_USE_BANDS)
+	#define DISPLAY_HAS_UPD 1	/* Drawing reaches the display through Display_Upd */
+#else
+	#define DISPLAY_HAS_UPD 0
+#endif
+
+#if defined(DISPLAY_USE_DMA) && !defined(DISPLAY_USE_HW_4SPI)
+	#error "DISPLAY_USE_DMA requires DISPLAY_USE_HW_4SPI"
+#endif
+
+#if defined(DISPLAY_USE_DMA) && !DISPLAY_HAS_BUFFER
+	#error "DISPLAY_USE_DMA sends the frame buffer, it requires DISPLAY_USE_BUFFER"
+#endif
+
+#if defined(DISPLAY_USE_BANDS) && (DISPLAY_BAND_HEIGHT < 1 || DISPLAY_BAND_HEIGHT > DISPLAY_HEIGHT)
+	#error "DISPLAY_BAND_HEIGHT must be 1..DISPLAY_HEIGHT"
+#endif
+
+#if DISPLAY_BUFFER_BPP != 16 && DISPLAY_BUFFER_BPP != 8 && DISPLAY_BUFFER_BPP != 4
+	#error "DISPLAY_BUFFER_BPP must be 16, 8 or 4"
+#endif
+
+#define FRAME_BUFFER_SIZE (DISPLAY_WIDTH * DISPLAY_HEIGHT * DISPLAY_BUFFER_BPP / 8)
+
+/* Word alignment of the pixel buffers: they are written with 32 bit stores and read by DMA in halfwords */
+#if !defined(DISPLAY_ALIGN4)
+#if defined(__GNUC__) || defined(__CC_ARM)
+	#define DISPLAY_ALIGN4 __attribute__((aligned(4)))
+#else
+	#error "Define DISPLAY_ALIGN4 to align a struct member to 4 bytes with this compiler"
+#endif
+#endif
 
 #define COLOR_BLACK		(uint16_t)0x0000	/* Most used RGB colors */
 #define COLOR_RED		(uint16_t)0xF800
@@ -34,6 +86,179 @@ extern "C" {
 #define COLOR_BROWN 		(uint16_t)0x9260
 #define COLOR_WHITE		(uint16_t)0xFFFF
 
+#define COLOR_INDEX_BLACK	(uint16_t)0	/* Entries of the default palette, the rest are black */
+#define COLOR_INDEX_RED		(uint16_t)1
+#define COLOR_INDEX_GREEN	(uint16_t)2
+#define COLOR_INDEX_BLUE	(uint16_t)3
+#define COLOR_INDEX_YELLOW	(uint16_t)4
+#define COLOR_INDEX_CYAN	(uint16_t)5
+#define COLOR_INDEX_MAGENTA	(uint16_t)6
+#define COLOR_INDEX_BROWN	(uint16_t)7
+#define COLOR_INDEX_WHITE	(uint16_t)8
+
+#define DISPLAY_HSCROLL_TEST	(uint8_t)0x00	/* Horizontal scroll step intervals (0x96 parameter E) */
+#define DISPLAY_HSCROLL_NORMAL	(uint8_t)0x01
+#define DISPLAY_HSCROLL_SLOW	(uint8_t)0x02
+#define DISPLAY_HSCROLL_SLOWEST	(uint8_t)0x03
+
+/* Packed RGB565 image (Display_DrawPackedIMG): width, height, then ops in raster order.
+ * The op is in the top 2 bits, the low 6 bits are its argument n */
+#define DISPLAY_PACK_HEADER	2		/* Width and height bytes */
+#define DISPLAY_PACK_RUN	(uint8_t)0x00	/* Previous pixel n + 1 more times */
+#define DISPLAY_PACK_LITERAL	(uint8_t)0x40	/* n + 1 pixels follow, 2 bytes each, MSB first */
+#define DISPLAY_PACK_INDEX	(uint8_t)0x80	/* Recent color n */
+#define DISPLAY_PACK_DIFF	(uint8_t)0xC0	/* Previous pixel + (r, g, b), each 2 bit field is the delta + 2 */
+#define DISPLAY_PACK_RECENT	64		/* Recent colors, literal and diff pixels are kept at DISPLAY_PACK_HASH */
+
+#define DISPLAY_PACK_HASH(color)	((((color) >> 11) * 3 + (((color) >> 5) & 0x3F) * 5 + ((color) & 0x1F) * 7) & 0x3F)
+
+/*
+ * @brief Rectangle in display coordinates, both corners inclusive
+ */
+struct Display_Rect
+{
+	uint8_t x0;
+	uint8_t y0;
+	uint8_t x1;
+	uint8_t y1;
+};
+
+#if defined(DISPLAY_USE_BANDS)
+/*
+ * @brief Recorded draw call of the display list
+ */
+struct Display_ListEntry
+{
+	uint8_t op;		/* DISPLAY_OP_... of SSD1351GL.c */
+	uint8_t drawMode;
+	uint8_t y0;		/* Rows the call touches, bands outside are skipped */
+	uint8_t y1;
+	uint8_t args[4];	/* Coordinates as passed to the draw call */
+	uint16_t drawColor;	/* Images: source row stride in bytes */
+	uint16_t backColor;	/* Images: transparent color */
+	const void *data;	/* Bitmap (must stay valid until Display_Upd) or text, radius, width, points copied into listText */
+};
+#endif
+
+#if DISPLAY_HAS_UPD
+
+struct SSD1351;
+
+/*
+ * @brief SPI bus shared by several displays (display->bus)
+ *	Keeps the transfers of the displays apart and sends their queued updates back to back
+ */
+struct Display_Bus
+{
+	struct SSD1351 *displays[DISPLAY_BUS_DISPLAYS];	/* Attached by Display_Init */
+	uint8_t count;
+	uint8_t turn;	/* Display the round robin starts looking at */
+	struct SSD1351 * volatile owner;	/* Display whose DMA update holds the bus, NULL - bus is free */
+};
+#endif
+
+#if defined(DISPLAY_USE_CONSOLE)
+
+#define DISPLAY_CONSOLE_COLUMNS	(DISPLAY_WIDTH / (DISPLAY_FONT_WIDTH + 1))	/* 21 x 14 cells of 6x9 pixels */
+#define DISPLAY_CONSOLE_ROWS	(DISPLAY_HEIGHT / (DISPLAY_FONT_HEIGHT + 1))
+
+/*
+ * @brief Text console state
+ */
+struct Display_Console
+{
+	uint8_t cells[DISPLAY_CONSOLE_ROWS][DISPLAY_CONSOLE_COLUMNS];	/* Ring of lines, 0 - empty cell */
+	uint8_t top;		/* Line shown at the top of the screen */
+	uint8_t row;		/* Cursor cell, row 0 is the top of the screen */
+	uint8_t column;		/* == DISPLAY_CONSOLE_COLUMNS: line is full, wraps on the next character */
+};
+#endif
+
+#if defined(DISPLAY_USE_SPRITES)
+
+#define DISPLAY_SPRITE_IMG	(uint8_t)0	/* RGB565 image, as for Display_DrawIMG */
+#define DISPLAY_SPRITE_IMG_KEY	(uint8_t)1	/* RGB565 image, pixels of the sprite color are transparent */
+#define DISPLAY_SPRITE_XBM	(uint8_t)2	/* Monochrome bitmap, set bits in the sprite color, the rest transparent */
+
+#define DISPLAY_SPRITE_NONE	(uint8_t)0xFF	/* Display_SpriteAdd: the pool is full */
+
+/*
+ * @brief Sprite of the pool (display->sprites)
+ */
+struct Display_Sprite
+{
+	const uint8_t *image;
+	int16_t x;		/* Screen position of the top left corner, may be partly off the screen */
+	int16_t y;
+	uint8_t width;
+	uint8_t height;
+	uint8_t format;		/* DISPLAY_SPRITE_... */
+	uint16_t color;		/* Transparent color (IMG_KEY) or color of the set bits (XBM) */
+	uint8_t z;		/* Sprites with higher z are drawn over the others, equal z in pool order */
+	uint8_t used;		/* 0 - free pool entry */
+	uint8_t visible;
+	uint8_t changed;	/* Has to be drawn again by Display_SpritesUpd */
+	struct Display_Rect shown;	/* Screen pixels it covered after the last Display_SpritesUpd, x0 > x1 - none */
+};
+#endif
+
+#if defined(DISPLAY_USE_STATS)
+/*
+ * @brief Bus statistics collected by the library
+ */
+struct Display_Stats
+{
+	uint32_t commands;	/* Command bytes sent */
+	uint32_t dataBytes;	/* Data bytes sent: command parameters and pixels */
+	uint32_t zones;		/* Draw zone changes */
+	uint32_t flushes;	/* Display_Upd calls that sent something */
+	uint32_t updCycles;	/* Cycles spent in Display_Upd (DWT cycle counter, host: nanoseconds) */
+	uint32_t initCycles;	/* Cycles the last Display_Init took from reset to the first frame on the panel */
+};
+#endif
+
+struct SSD1351;
+
+/*
+ * @brief Bus the display is attached to (display->transport)
+ *	Every byte of the library goes through these operations. The write operations are called
+ *	between begin and end and may return before their last frame is sent, end waits for it
+ */
+struct Display_Transport
+{
+	void (*init)(struct SSD1351 *display);		/* Set up the bus and the CLK and DATA pins, may be NULL */
+	void (*begin)(struct SSD1351 *display);		/* Select the display (CS = 0) */
+	void (*end)(struct SSD1351 *display);		/* Wait for the last frame, unselect the display */
+	void (*command)(struct SSD1351 *display, uint8_t command, const uint8_t *data, uint16_t length);	/* Command (DC = 0), then its parameters (DC = 1) */
+	void (*write)(struct SSD1351 *display, const uint8_t *data, uint32_t length);			/* Data bytes */
+	void (*writePixels)(struct SSD1351 *display, const uint16_t *pixels, uint32_t count);		/* RGB565 words, most significant byte first */
+	void (*writeRepeat)(struct SSD1351 *display, uint16_t color, uint32_t count);			/* One RGB565 word count times */
+	void (*writeAsync)(struct SSD1351 *display, const uint16_t *pixels, uint16_t count);		/* Start sending words in the background, NULL - not offered */
+};
+
+#if defined(DISPLAY_USE_HW_4SPI)
+extern const struct Display_Transport Display_HwSpiTransport;	/* SPI unit display->spi, the CPU feeds every frame */
+#endif
+
+#if defined(DISPLAY_USE_DMA)
+extern const struct Display_Transport Display_DmaSpiTransport;	/* SPI unit, Display_Upd hands the frame buffer to display->dmaStream */
+#endif
+
+#if defined(DISPLAY_USE_SW_4SPI)
+extern const struct Display_Transport Display_SwSpiTransport;	/* CLK and DATA pins driven by the CPU */
+#endif
+
+/*
+ * Panel setup sequence replayed by Display_Init (display->initSequence). Every entry is
+ *	command, parameter count (| DISPLAY_INIT_DELAY), parameters[, delay in ms]
+ * and the sequence ends with DISPLAY_INIT_END. It should leave the display off (0xAE):
+ * Display_Init sends the first frame and turns the display on after it
+ */
+#define DISPLAY_INIT_DELAY	0x80	/* Parameter count flag: a delay in ms follows the parameters */
+#define DISPLAY_INIT_END	0xFF	/* Not an SSD1351 command */
+
+extern const uint8_t Display_InitSequence[];	/* Setup of the usual 128x128 panel */
+
 /*
  * @brief Struct that contains information about display
  */
@@ -53,45 +278,180 @@ struct SSD1351
 	GPIO_TypeDef *dataPinPort; /* Ports that contains DATA and CLK pins*/
 	GPIO_TypeDef *clkPinPort;
 
+	const struct Display_Transport *transport;	/* NULL - Display_Init picks the one of the configuration (DMA, hardware, software SPI) */
+
+	const uint8_t *initSequence;	/* Panel setup, see DISPLAY_INIT_DELAY. NULL - Display_InitSequence */
+	const uint16_t *splash;		/* First frame shown by Display_Init, DISPLAY_WIDTH x DISPLAY_HEIGHT RGB565 colors row by row. NULL - back color */
+
 #if defined(DISPLAY_USE_HW_4SPI)
 
 	SPI_TypeDef *spi;	/* SPI unit that will be used in Hardware SPI Mode*/
+	uint8_t spiAltFunc;	/* Alternate function of CLK and DATA, 0 - the usual one of the SPI unit (AF6 for SPI3, AF5 otherwise) */
 
 #endif	/* DISPLAY_USE_HW_4SPI */
 
+#if defined(DISPLAY_USE_DMA)
+
+	DMA_TypeDef *dma;			/* DMA unit and stream that serve the SPI TX request */
+	DMA_Stream_TypeDef *dmaStream;
+	uint8_t dmaStreamNum;			/* Stream number (0..7) */
+	uint8_t dmaChannel;			/* Channel that routes SPI TX to the stream */
+
+	volatile uint8_t updBusy;		/* Set while the frame buffer is being sent */
+	void (*updCallback)(struct SSD1351 *display);	/* Called from the DMA interrupt when the update is finished */
+
+	struct Display_Rect updRects[DISPLAY_DIRTY_RECTS];	/* Snapshot of the dirty list being sent */
+	uint8_t updCount;
+	uint8_t updIndex;	/* Rectangle being sent */
+	uint8_t updRow;		/* Next row of that rectangle */
+	uint8_t updZoneEnd;	/* Last row of the open draw zone */
+
+#if DISPLAY_INDEXED
+	uint16_t updLine[2][DISPLAY_WIDTH];	/* Rows expanded through the palette: one is sent while the next is prepared */
+	uint8_t updLineSel;	/* Line the next transfer sends */
+	uint8_t updLineReady;	/* That line already holds updRow */
+#endif
+
+#endif	/* DISPLAY_USE_DMA */
+
 #if DISPLAY_HAS_BUFFER
 
-	uint8_t frameBuffer[DISPLAY_WIDTH * DISPLAY_HEIGHT * 2]; /* Buffer that contains display frame */
+	uint8_t frameBuffer[FRAME_BUFFER_SIZE] DISPLAY_ALIGN4; /* Buffer that contains display frame */
+
+#if DISPLAY_INDEXED
+	uint16_t palette[1 << DISPLAY_BUFFER_BPP];	/* RGB565 color of each index, expanded by Display_Upd */
+#endif
 
 #endif /* DISPLAY_HAS_BUFFFER */
 
+#if defined(DISPLAY_USE_BANDS)
+
+	uint16_t band[DISPLAY_WIDTH * DISPLAY_BAND_HEIGHT] DISPLAY_ALIGN4;	/* Strip the display list is rendered into */
+	uint8_t bandY;		/* Screen row of band[0] */
+	uint8_t bandRows;	/* Rows being rendered, 0 when not replaying */
+	uint8_t bandDrawn[DISPLAY_WIDTH * DISPLAY_BAND_HEIGHT / 8];	/* Pixels the partial list drew, 1 bit each */
+
+	struct Display_ListEntry list[DISPLAY_LIST_SIZE];	/* Draw calls since the last Display_Clear/Display_Fill */
+	uint8_t listCount;
+	uint8_t listText[DISPLAY_LIST_TEXT];
+	uint16_t listTextUsed;
+	uint8_t listPartial;	/* List overflowed or the screen scrolled: the list draws over the image on the display */
+
+#endif /* DISPLAY_USE_BANDS */
+
+#if DISPLAY_HAS_UPD
+
+	struct Display_Rect dirty[DISPLAY_DIRTY_RECTS];	/* Parts of the frame changed since the last update */
+	uint8_t dirtyCount;
+
+	struct Display_Bus *bus;	/* SPI bus shared with other displays, NULL - the display has its own */
+	uint8_t updPriority;		/* Flush scheduler: higher priorities are sent first, equal ones take turns */
+	volatile uint8_t updQueued;	/* Update requested by Display_RequestUpd and not started yet */
+
+#endif /* DISPLAY_HAS_UPD */
+
 	uint16_t currentDrawColor;
 	uint16_t currentBackColor;
 
 	uint8_t drawMode;
+	uint8_t alpha;		/* Opacity of DISPLAY_DRAW_MODE_BLEND, 255 - opaque */
+
+	struct Display_Rect clip;	/* Screen pixels drawing may change */
+	int16_t originX;	/* Screen position of drawing coordinate (0, 0) */
+	int16_t originY;
 
 	int16_t cursorX;	/* Cursor position. Used  */
 	int16_t cursorY;
 
+	uint8_t startLine;	/* Display start line (0xA1) and offset (0xA2) */
+	uint8_t lineOffset;
+	uint8_t scrollY;	/* Display RAM row shown at screen row 0 */
+	uint8_t inverse;	/* Inverse display (0xA7) is on */
+
+	uint8_t hScrollY;	/* Screen rows moved by the horizontal scroll engine */
+	uint8_t hScrollHeight;	/* 0 while the engine is stopped */
+
+#if defined(DISPLAY_USE_CONSOLE)
+
+	struct Display_Console console;
+
+#endif	/* DISPLAY_USE_CONSOLE */
+
+#if defined(DISPLAY_USE_SPRITES)
+
+	struct Display_Sprite sprites[DISPLAY_SPRITES];
+	void (*spriteBackground)(struct SSD1351 *display, const struct Display_Rect *rect);	/* Draws the background of a rectangle, NULL - fill with currentBackColor */
+
+#endif	/* DISPLAY_USE_SPRITES */
+
+#if defined(DISPLAY_USE_STATS)
+
+	struct Display_Stats stats;
+
+#endif	/* DISPLAY_USE_STATS */
+
 };
 
 void Display_Init(struct SSD1351 *display);
 
 void Display_Clear(struct SSD1351 *display);
 
-#if DISPLAY_HAS_BUFFER
+#if DISPLAY_HAS_UPD
 void Display_Upd(struct SSD1351 *display);
+uint8_t Display_IsBusy(struct SSD1351 *display);
+void Display_WaitUpd(struct SSD1351 *display);
+void Display_Invalidate(struct SSD1351 *display);
+void Display_InvalidateRect(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height);
+uint32_t Display_GetUpdSize(struct SSD1351 *display);
+void Display_RequestUpd(struct SSD1351 *display);
+void Display_BusFlush(struct Display_Bus *bus);
+uint8_t Display_BusIsBusy(struct Display_Bus *bus);
+#endif
+
+#if defined(DISPLAY_USE_DMA)
+void Display_SetUpdCallback(struct SSD1351 *display, void (*callback)(struct SSD1351 *display));
+void Display_DmaIrqHandler(struct SSD1351 *display);
+void Display_BusIrqHandler(struct Display_Bus *bus);
+#endif
+
+void Display_WriteCommand(struct SSD1351 *display, uint8_t command, const uint8_t *data, uint16_t length);
+void Display_WriteData(struct SSD1351 *display, const uint8_t *data, uint32_t length);
+void Display_WriteColor(struct SSD1351 *display, uint16_t color, uint32_t count);
+
+#if DISPLAY_INDEXED
+void Display_SetPalette(struct SSD1351 *display, uint8_t first, uint16_t count, const uint16_t *colors);
 #endif
 
 void Display_SetDrawColor(struct SSD1351 *display, uint16_t color);
 void Display_SetBackColor(struct SSD1351 *display, uint16_t color);
 void Display_SetDrawMode(struct SSD1351 *display, uint8_t mode);
+void Display_SetAlpha(struct SSD1351 *display, uint8_t alpha);
+
+void Display_SetClip(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height);
+void Display_ResetClip(struct SSD1351 *display);
+void Display_SetOrigin(struct SSD1351 *display, int16_t x, int16_t y);
+void Display_SetViewport(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height);
+
+#if defined(DISPLAY_USE_STATS)
+void Display_GetStats(struct SSD1351 *display, struct Display_Stats *stats);
+void Display_ResetStats(struct SSD1351 *display);
+#endif
 
 void Display_DrawPixel(struct SSD1351 *display, uint8_t x, uint8_t y, uint16_t color);
 void Display_ClearPixel(struct SSD1351 *display, uint8_t x, uint8_t y);
 void Display_DrawLine(struct SSD1351 *display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+void Display_DrawLineAA(struct SSD1351 *display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+void Display_DrawThickLine(struct SSD1351 *display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t width);
+void Display_DrawPolyline(struct SSD1351 *display, const uint8_t points[], uint8_t count);
 void Display_Fill( struct SSD1351 * display, uint16_t color );
 void Display_Invert(struct SSD1351 *display);
+void Display_SetInverse(struct SSD1351 *display, uint8_t inverse);
+
+void Display_SetStartLine(struct SSD1351 *display, uint8_t line);
+void Display_SetOffset(struct SSD1351 *display, uint8_t offset);
+void Display_ScrollV(struct SSD1351 *display, int16_t rows);
+void Display_StartScrollH(struct SSD1351 *display, int8_t shift, uint8_t y, uint8_t height, uint8_t speed);
+void Display_StopScrollH(struct SSD1351 *display);
 
 void Display_DrawAsciiChar(struct SSD1351 *display, uint8_t str, uint8_t col, uint8_t asciiChr);
 void Display_PrintNum(struct SSD1351 *display, int32_t num);
@@ -101,11 +461,47 @@ void Display_PrintString(struct SSD1351 *display, char str[]);
 
 void Display_DrawFrame(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height);
 void Display_DrawBox(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height);
+void Display_DrawRFrame(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t r);
+void Display_DrawRBox(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t r);
+void Display_DrawCircle(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t r);
+void Display_DrawDisc(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t r);
+void Display_DrawEllipse(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t rx, uint8_t ry);
+void Display_DrawFilledEllipse(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t rx, uint8_t ry);
+void Display_DrawTriangle(struct SSD1351 *display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2);
+void Display_DrawFilledTriangle(struct SSD1351 *display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2);
+void Display_DrawPolygon(struct SSD1351 *display, const uint8_t points[], uint8_t count);
+void Display_DrawFilledPolygon(struct SSD1351 *display, const uint8_t points[], uint8_t count);
 
 void Display_DrawXBM(struct SSD1351 *display, uint8_t xbmStartx, uint8_t xbmStarty, uint8_t xbmWidth, uint8_t xbmHeight, uint8_t xbm[]);
 void Display_DrawIMG(struct SSD1351 *display, uint8_t imgStartx, uint8_t imgStarty, uint8_t imgW, uint8_t imgH, uint8_t img[]);
+void Display_DrawIMGKey(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t imgW, uint8_t imgH, const uint8_t img[], uint16_t key);
+void Display_DrawIMGPart(struct SSD1351 *display, uint8_t x, uint8_t y, const uint8_t sheet[], uint8_t sheetW,
+		uint8_t srcX, uint8_t srcY, uint8_t width, uint8_t height);
+void Display_DrawIMGPartKey(struct SSD1351 *display, uint8_t x, uint8_t y, const uint8_t sheet[], uint8_t sheetW,
+		uint8_t srcX, uint8_t srcY, uint8_t width, uint8_t height, uint16_t key);
+void Display_DrawPackedIMG(struct SSD1351 *display, uint8_t x, uint8_t y, const uint8_t img[]);
+void Display_DrawIMGAlpha(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t imgW, uint8_t imgH, const uint8_t img[], const uint8_t alpha[]);
+void Display_DrawAlphaMask(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t maskW, uint8_t maskH, const uint8_t mask[]);
+
+void Display_Printf(struct SSD1351 *display, const char *format, ...);
+
+#if defined(DISPLAY_USE_CONSOLE)
+void Display_ConsolePutChar(struct SSD1351 *display, uint8_t asciiChr);
+void Display_ConsolePrint(struct SSD1351 *display, const char *str);
+void Display_ConsoleClear(struct SSD1351 *display);
+void Display_ConsoleRedraw(struct SSD1351 *display);
+#endif
 
-void Display_Printf(struct SSD1351 *display, const char *format, ...); //todo
+#if defined(DISPLAY_USE_SPRITES)
+uint8_t Display_SpriteAdd(struct SSD1351 *display, int16_t x, int16_t y, uint8_t width, uint8_t height, const uint8_t image[], uint8_t format, uint16_t color);
+void Display_SpriteRemove(struct SSD1351 *display, uint8_t sprite);
+void Display_SpriteMove(struct SSD1351 *display, uint8_t sprite, int16_t x, int16_t y);
+void Display_SpriteShow(struct SSD1351 *display, uint8_t sprite, uint8_t visible);
+void Display_SpriteSetImage(struct SSD1351 *display, uint8_t sprite, const uint8_t image[]);
+void Display_SpriteSetZ(struct SSD1351 *display, uint8_t sprite, uint8_t z);
+void Display_SetSpriteBackground(struct SSD1351 *display, void (*background)(struct SSD1351 *display, const struct Display_Rect *rect));
+void Display_SpritesUpd(struct SSD1351 *display);
+#endif
 
 #if defined(__cplusplus)
 }
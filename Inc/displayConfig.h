@@ -13,21 +13,72 @@
 #define DISPLAY_WIDTH 128	/* display width in pixels */
 
 
-//#define DISPLAY_USE_BUFFER  	/* full graphic buffer for display. Requires 32k bytes of ram */
+#if !defined(DISPLAY_NO_BUFFER)	/* -DDISPLAY_NO_BUFFER: draw straight to the display */
+	#define DISPLAY_USE_BUFFER  	/* full graphic buffer for display. Requires 32k bytes of ram */
+#endif
+
+/* Frame buffer format: 16 - RGB565 (32k), 8 or 4 - palette indices (16k / 8k).
+ * With a palette the draw and back colors are indices, Display_SetPalette sets their RGB565 colors */
+#if !defined(DISPLAY_BUFFER_BPP)
+	#define DISPLAY_BUFFER_BPP 16
+#endif
+
+/* Banded rendering for targets without 32k of ram, replaces DISPLAY_USE_BUFFER when defined.
+ * Draw calls are recorded into a display list, Display_Upd replays it once per horizontal band
+ * of DISPLAY_BAND_HEIGHT rows and sends the changed parts of the band (128x16: 4k bytes, plus 256 bytes of drawn pixel bits) */
+/* #define DISPLAY_USE_BANDS */
+
+#define DISPLAY_BAND_HEIGHT 16		/* Rows per band, any height from 1 to DISPLAY_HEIGHT */
+#define DISPLAY_LIST_SIZE 64		/* Display list entries (16 bytes each) */
+#define DISPLAY_LIST_TEXT 256		/* Bytes for the text of recorded strings and polygon and polyline points */
 
 #if defined(DISPLAY_USE_FULL_BUFFER)
 	#define	DISPLAY_BUFFER_SIZE 32768
 #endif
 
+#define DISPLAY_DIRTY_RECTS 4	/* Changed regions tracked between updates, 1 turns it into a single bounding box */
+
+#define DISPLAY_BUS_DISPLAYS 4	/* Displays that can share one SPI bus (struct Display_Bus) */
+
+
+/* Text console (Display_Console*): character cell ring buffer, scrolled with the display start line.
+ * Costs one cell per character on the screen, about 300 bytes of ram per display */
+/* #define DISPLAY_USE_CONSOLE */
+
+#define DISPLAY_CONSOLE_TAB 4	/* Tab stops every 4 cells */
+
 
-/* Select the communication interface for the display */
+/* Sprite layer (Display_Sprite*): bitmaps moved over a background, Display_SpritesUpd draws again
+ * only the rectangles the sprites left or entered and sends only those.
+ * Costs the DISPLAY_SPRITES pool in ram per display and the sprite code in flash */
+/* #define DISPLAY_USE_SPRITES */
+
+#define DISPLAY_SPRITES 8	/* Sprites in the pool (about 20 bytes each) */
+
+
+/* Count commands, data bytes, draw zones, updates and Display_Upd cycles in display->stats */
+/* #define DISPLAY_USE_STATS */
+
+
+/* Select the communication interface for the display.
+ * Each option builds a transport (struct Display_Transport), display->transport picks one per display.
+ * Display_Init uses DMA, then hardware SPI, then software SPI when it is left NULL */
 
 /* Display use hardware SPI unit (4-wire mode) */
 #define DISPLAY_USE_HW_4SPI
 
-/* Display use software emulated SPI (4-wire mode) */
+/* Send the frame buffer with DMA, Display_Upd returns immediately (hardware SPI only) */
+/* #define DISPLAY_USE_DMA */
+
+/* Display use software emulated SPI (4-wire mode) on the CLK and DATA pins */
 /* #define DISPLAY_USE_SW_4SPI */
 
+/* Delay after each CLK edge of the software SPI. The SSD1351 needs CLK high and low for 20 ns at least (20 MHz),
+ * e.g. __NOP() when the core writes BSRR faster than that */
+#if !defined(DISPLAY_SW_SPI_HOLD)
+	#define DISPLAY_SW_SPI_HOLD()
+#endif
+
 /* Display use hardware I2C(TWI) unit */
 /* #define DISPLAY_USE_I2C */
 
@@ -43,8 +94,12 @@
 #define DISPLAY_DEFAULT_BACK_COLOR COLOR_BLACK
 #define DISPLAY_DEFAULT_DRAW_COLOR COLOR_WHITE
 
+#define DISPLAY_DEFAULT_BACK_INDEX COLOR_INDEX_BLACK	/* Palette frame buffer defaults */
+#define DISPLAY_DEFAULT_DRAW_INDEX COLOR_INDEX_WHITE
+
 #define DISPLAY_DRAW_MODE_OVERRIDE 	(uint8_t)1
 #define DISPLAY_DRAW_MODE_COMPOSE 	(uint8_t)0
+#define DISPLAY_DRAW_MODE_BLEND 	(uint8_t)2	/* COMPOSE with the global alpha (Display_SetAlpha) */
 
 #define DISPLAY_DEFAULT_DRAW_MODE 	DISPLAY_DRAW_MODE_OVERRIDE
 
@@ -1,710 +1,6296 @@
 #include "SSD1351GL.h"
 #include "stdFont_5x8.h"
-#include <math.h>
-
-static void Display_Command( struct SSD1351 * display, uint8_t command );
-static void Display_Data( struct SSD1351 *display, uint8_t data );
-static void Display_SetDrawZone( struct SSD1351 * display, uint8_t x0, uint8_t y0, uint8_t width, uint8_t height );
-
-/*
- *	@brief 	Initialize display
- *		Initialization is carried out in 4 stages:
- * 		1) GPIO initialization
- * 		2) SPI/I2C initialization,
- * 		3) Send a packet of control bytes for initial display setup.
- * 		4) Set display in default mode
- * 
- *	@param	Ptr to the SSD1351 struct
- * 
- *	@retval none
- */
-void Display_Init( struct SSD1351 * display )
-{
-	uint16_t i;
-
-	RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_GPIOBEN | RCC_AHB1ENR_GPIOCEN; /* Enable GPIO */
-
-#if defined(DISPLAY_USE_HW_4SPI)
-
-	GPIO_InitPin(display->clkPinPort, display->clkPin, GPIO_MODE_ALT); /* Set CLK as alternate output */
-	GPIO_InitPin(display->dataPinPort, display->dataPin, GPIO_MODE_ALT); /* Set DATA as alternate output */
-
-	GPIO_SetAltMode(display->clkPinPort, display->clkPin, 0x05);
-	GPIO_SetAltMode(display->dataPinPort, display->dataPin, 0x05);
-
-	RCC->APB2ENR |= RCC_APB2ENR_SPI1EN;	/* Enable SPI */
-
-	display->spi->CR1 |= SPI_CR1_MSTR | SPI_CR1_SSI | SPI_CR1_SSM | SPI_CR1_SPE | SPI_CR1_BR_0; /* Init SPI as master */
-
-#elif defined(DISPLAY_USE_SW_SPI)
-
-	//GPIO_configPin(display->clkPinPort, display->clkPin, GPIO_OUTPUT_PUSH_PULL);	/* Set CLK as output */
-	//GPIO_configPin(display->dataPinPort, display->dataPin, GPIO_OUTPUT_PUSH_PULL);	/* Set DATA as output */
+#include <string.h>
 
+#if defined(LIB2F4_HOST)
+#define DISPLAY_SPI_WRITE(spi, value)	SPI_HostWrite((spi), (value))	/* Host stand-in models the bus behind DR */
+#define DISPLAY_GPIO_BSRR(port, value)	GPIO_HostBsrr((port), (value))	/* and the pins behind BSRR */
+#else
+#define DISPLAY_SPI_WRITE(spi, value)	((spi)->DR = (value))
+#define DISPLAY_GPIO_BSRR(port, value)	((port)->BSRR = (value))
 #endif
 
-	GPIO_InitPin(display->csPinPort, display->csPin, GPIO_MODE_OUTPUT | GPIO_OSPEED_50MHZ);
-	GPIO_InitPin(display->dcPinPort, display->dcPin, GPIO_MODE_OUTPUT | GPIO_OSPEED_50MHZ);
-	GPIO_InitPin(display->resPinPort, display->resPin, GPIO_MODE_OUTPUT | GPIO_OSPEED_50MHZ);
+#if defined(DISPLAY_USE_STATS)
 
-	//GPIO_configPin(display->csPinPort, display->csPin, GPIO_OUTPUT_PUSH_PULL);	/* Set CS, DC, RES as output */
-	//GPIO_configPin(display->dcPinPort, display->dcPin, GPIO_OUTPUT_PUSH_PULL);
-	//GPIO_configPin(display->resPinPort, display->resPin, GPIO_OUTPUT_PUSH_PULL);
+#if defined(LIB2F4_HOST)
+#define DISPLAY_CYCLES()	Host_CycleCount()
+#else
+#define DISPLAY_CYCLES()	(DWT->CYCCNT)
+#endif
 
-	GPIO_SetPin(display->csPinPort, display->csPin, 1);		/* Unselect display (CS = 1) */
-	GPIO_SetPin(display->resPinPort, display->resPin, 0);	/* Reset display (RES = 0) */
+#define DISPLAY_STAT_ADD(display, field, value)	((display)->stats.field += (value))
+#else
+#define DISPLAY_STAT_ADD(display, field, value)
+#endif
 
-	for(i = 0; i < 1024; i++); 	/* Delay */
-	_delay_ms(1);
+#define DISPLAY_CURSOR_OFFSET_X	(uint8_t)(DISPLAY_FONT_WIDTH + 1)	/* Character cell: glyph plus one spacing column and row */
+#define DISPLAY_CURSOR_OFFSET_Y	(uint8_t)(DISPLAY_FONT_HEIGHT + 1)
 
-	GPIO_SetPin(display->resPinPort, display->resPin, 1);	/* End reset (RES = 1) */
+#define DISPLAY_ROW_BYTES	(DISPLAY_WIDTH * DISPLAY_BUFFER_BPP / 8)	/* Frame buffer row */
 
-	/* Send control bytes to the display */
+#if DISPLAY_INDEXED
+static const uint16_t defaultPalette[] =	/* Colors of COLOR_INDEX_BLACK..COLOR_INDEX_WHITE */
+{
+	COLOR_BLACK, COLOR_RED, COLOR_GREEN, COLOR_BLUE, COLOR_YELLOW, COLOR_CYAN, COLOR_MAGENTA, COLOR_BROWN, COLOR_WHITE
+};
 
-	/* Set command lock */
-	Display_Command(display, 0xFD);
-	Display_Data(display, 0x12);
+#if DISPLAY_BUFFER_BPP == 8
+#define DISPLAY_INDEX_BYTE(color)	(uint8_t)(color)	/* Byte of the frame buffer filled with one index */
+#else
+#define DISPLAY_INDEX_BYTE(color)	(uint8_t)(((color) & 0x0F) * 0x11)
+#endif
+#endif
 
-	/* Set command lock */
-	Display_Command(display, 0xFD);
-	Display_Data(display, 0xB1);
+#if !DISPLAY_HAS_BUFFER
+static void Display_SetDrawZone( struct SSD1351 * display, uint8_t x0, uint8_t y0, uint8_t width, uint8_t height );
+#endif
+static void Display_Begin( struct SSD1351 * display );
+static void Display_End( struct SSD1351 * display );
+static inline void Display_PutPixel( struct SSD1351 * display, uint8_t x, uint8_t y, uint16_t color );
+static void Display_FillRect( struct SSD1351 * display, uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint16_t color );
+static void Display_DrawTextRun( struct SSD1351 * display, uint8_t x, uint8_t y, const uint8_t * str, uint8_t count );
+static void Display_BlitIMG( struct SSD1351 * display, uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+		const uint8_t * src, uint16_t stride, uint8_t keyed, uint16_t key );
+
+#if DISPLAY_HAS_UPD
+static void Display_MarkDirty( struct SSD1351 * display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1 );
+static void Display_BusService( struct Display_Bus * bus );
+#if defined(DISPLAY_USE_DMA)
+static void Display_BusServiceIrq( struct Display_Bus * bus );
+#endif
+#else
+#define Display_MarkDirty(display, x0, y0, x1, y1)
+#define Display_WaitUpd(display)	/* Nothing is sent in the background without a frame buffer */
+#endif
 
-	/* Turn display off */
-	Display_Command(display, 0xAE);
+#if defined(DISPLAY_USE_BANDS)
+
+#define DISPLAY_OP_FILL		0	/* Display list operations */
+#define DISPLAY_OP_PIXEL	1
+#define DISPLAY_OP_LINE		2
+#define DISPLAY_OP_FRAME	3
+#define DISPLAY_OP_BOX		4
+#define DISPLAY_OP_TEXT		5
+#define DISPLAY_OP_XBM		6
+#define DISPLAY_OP_PACKED	7
+#define DISPLAY_OP_IMG		8
+#define DISPLAY_OP_IMG_KEY	9
+#define DISPLAY_OP_VIEW		10	/* Clip rectangle and origin of the calls that follow */
+#define DISPLAY_OP_ELLIPSE	11
+#define DISPLAY_OP_FILLED_ELLIPSE 12
+#define DISPLAY_OP_RFRAME	13	/* Corner radius copied into listText */
+#define DISPLAY_OP_RBOX		14
+#define DISPLAY_OP_POLYGON	15	/* Corners copied into listText */
+#define DISPLAY_OP_FILLED_POLYGON 16
+#define DISPLAY_OP_POLYLINE	17	/* Points copied into listText */
+#define DISPLAY_OP_THICK_LINE	18	/* Width copied into listText */
+
+static uint8_t Display_ListAdd( struct SSD1351 * display, uint8_t op, const uint8_t * args, const void * data, const struct Display_Rect * box );
+static void Display_RenderBand( struct SSD1351 * display, uint8_t y );
+static void Display_ListView( struct SSD1351 * display );
+static void Display_ListFlush( struct SSD1351 * display );
+static void Display_FillRows( uint16_t * row, uint8_t width, uint8_t height, uint16_t color );
+
+#define DISPLAY_BAND_DRAWN(display, i)	((display)->bandDrawn[(i) >> 3] & (1 << ((i) & 0x07)))	/* Band pixel i drawn by a partial list */
+
+/* Record a draw call instead of drawing it. Used where the call would mark its rectangle dirty */
+#define DISPLAY_RECORD(display, op, a0, a1, a2, a3, data, x0, y0, x1, y1) \
+	if(Display_ListAdd((display), (op), (const uint8_t []){ (a0), (a1), (a2), (a3) }, (data), &(const struct Display_Rect){ (x0), (y0), (x1), (y1) })) return
+#else
+#define DISPLAY_RECORD(display, op, a0, a1, a2, a3, data, x0, y0, x1, y1)
+#endif
 
-	/* Set display clock div */
-	Display_Command(display, 0xB3);
+/*
+ *	@brief	Enable the clock of a GPIO port
+ *		GPIOx ports are evenly spaced and their GPIOxEN bits follow the same order
+ *
+ *	@param	Port
+ *
+ *	@retval none
+ */
+static void Display_PortClockOn( GPIO_TypeDef * port )
+{
+	RCC->AHB1ENR |= 1UL << (((uintptr_t)port - (uintptr_t)GPIOA) / ((uintptr_t)GPIOB - (uintptr_t)GPIOA));
+}
 
-	/* 7:4 = oscillator frequency, 3:0 = CLK div ratio (A[3:0]+1 = 1..16) */
-	Display_Command(display, 0xF1);
 
-	/* Set display mux ratio */
-	Display_Command(display, 0xCA);
-	Display_Data(display, 0x7f);
+#if defined(DISPLAY_USE_HW_4SPI)
 
-	/* Set display remap */
-	Display_Command(display, 0xA0);
-	Display_Data(display, 0x74);
+/*
+ *	@brief	Enable the clock of the display SPI unit
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval	Alternate function of its CLK and DATA pins
+ */
+static uint8_t Display_SpiClockOn( struct SSD1351 * display )
+{
+	if(display->spi == SPI1) RCC->APB2ENR |= RCC_APB2ENR_SPI1EN;
+	else if(display->spi == SPI2) RCC->APB1ENR |= RCC_APB1ENR_SPI2EN;
+	else if(display->spi == SPI3) RCC->APB1ENR |= RCC_APB1ENR_SPI3EN;
+#if defined(SPI4)
+	else if(display->spi == SPI4) RCC->APB2ENR |= RCC_APB2ENR_SPI4EN;
+#endif
+#if defined(SPI5)
+	else if(display->spi == SPI5) RCC->APB2ENR |= RCC_APB2ENR_SPI5EN;
+#endif
 
-	/* Set display column */
-	Display_Command(display, 0x15);
-	Display_Data(display, 0x00);
-	Display_Data(display, 0x7F);
+	if(display->spiAltFunc) return display->spiAltFunc;
 
-	/* Set display row*/
-	Display_Command(display, 0x75);
-	Display_Data(display, 0x00);
-	Display_Data(display, 0x7F);
+	return display->spi == SPI3 ? 0x06 : 0x05;
+}
 
-	/* Set display start line */
-	Display_Command(display, 0xA1);
-	Display_Data(display, 0x00);
+#endif
 
-	/* Set display offset */
-	Display_Command(display, 0xA2);
-	Display_Data(display, 0x00);
 
-	/* Set display controller GPIO */
-	Display_Command(display, 0xB5);
-	Display_Data(display, 0x00);
+/*
+ *	Setup of the usual 128x128 panel, see DISPLAY_INIT_DELAY.
+ *	Column and row range are left to the first frame, the display is turned on after it
+ */
+const uint8_t Display_InitSequence[] =
+{
+	0xFD, 1, 0x12,			/* Set command lock */
+	0xFD, 1, 0xB1,			/* Set command lock */
+	0xAE, 0,			/* Turn display off */
+	0xB3, 1, 0xF1,			/* Set display clock div: 7:4 = oscillator frequency, 3:0 = CLK div ratio (A[3:0]+1 = 1..16) */
+	0xCA, 1, 0x7F,			/* Set display mux ratio */
+	0xA0, 1, 0x74,			/* Set display remap */
+	0xA1, 1, 0x00,			/* Set display start line */
+	0xA2, 1, 0x00,			/* Set display offset */
+	0xB5, 1, 0x00,			/* Set display controller GPIO */
+	0xAB, 1, 0x01,			/* Display function select */
+	0xB1, 1, 0x32,			/* Set display precharge */
+	0xBE, 1, 0x05,			/* Set display VCOMH */
+	0xA6, 0,			/* Set display normal state (not inverted) */
+	0xC1, 3, 0xC8, 0x80, 0xC8,	/* Set display contrast */
+	0xC7, 1, 0x0F,			/* Set CONTRASTMSTR */
+	0xB4, 3, 0xA0, 0xB5, 0x55,	/* Set display VSL */
+	0xB6, 1, 0x01,			/* Set display precharge2 */
+	DISPLAY_INIT_END
+};
 
-	/* Display function select */
-	Display_Command(display, 0xAB);
-	Display_Data(display, 0x01);
 
-	/* Set display precharge */
-	Display_Command(display, 0xB1);
-	Display_Data(display, 0x32);
+/*
+ *	@brief	Replay a panel setup sequence
+ *		Commands go out back to back in one transaction, it is only ended for the delays
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Sequence, see DISPLAY_INIT_DELAY
+ *
+ *	@retval none
+ */
+static void Display_RunSequence( struct SSD1351 * display, const uint8_t * sequence )
+{
+	uint8_t length, delay;
 
-	/* Set display VCOMH */
-	Display_Command(display, 0xBE);
-	Display_Data(display, 0x05);
+	Display_Begin(display);
 
-	/* Set display normal state (not inverted) */
-	Display_Command(display, 0xA6);
+	while(sequence[0] != DISPLAY_INIT_END)
+	{
+		length = sequence[1] & ~DISPLAY_INIT_DELAY;
+		delay = 0;
 
-	/* Set display contrast */
-	Display_Command(display, 0xC1);
-	Display_Data(display, 0xC8);
-	Display_Data(display, 0x80);
-	Display_Data(display, 0xC8);
+		display->transport->command(display, sequence[0], &sequence[2], length);
 
-	/* Set CONTRASTMSTR */
-	Display_Command(display, 0xC7);
-	Display_Data(display, 0x0F);
+		DISPLAY_STAT_ADD(display, commands, 1);
+		DISPLAY_STAT_ADD(display, dataBytes, length);
 
-	/* Set display VSL */
-	Display_Command(display, 0xB4);
-	Display_Data(display, 0xA0);
-	Display_Data(display, 0xB5);
-	Display_Data(display, 0x55);
+		if(sequence[1] & DISPLAY_INIT_DELAY) delay = sequence[2 + length++];
 
-	/* Set display precharge2 */
-	Display_Command(display, 0xB6);
-	Display_Data(display, 0x01);
+		sequence += 2 + length;
 
-	/* Turn display on */
-	Display_Command(display, 0xAF);
+		if(delay)
+		{
+			Display_End(display);
+			_delay_ms(delay);
 
-	Display_SetBackColor(display, DISPLAY_DEFAULT_BACK_COLOR);	/* Default color settings */
-	Display_SetDrawColor(display, DISPLAY_DEFAULT_DRAW_COLOR);
+			if(sequence[0] == DISPLAY_INIT_END) return;
 
-	Display_SetDrawMode(display, DISPLAY_DEFAULT_DRAW_MODE);
+			Display_Begin(display);
+		}
+	}
 
-	Display_Clear(display);	/* Clear display RAM */
+	Display_End(display);
 }
 
 
 /*
- *	@brief 	send command to display
- * 
- *	@param 	Ptr to the SSD1351 struct
- *	@param 	command to send
- * 
+ *	@brief	Send the first frame and turn the display on
+ *		The splash or the back color goes out as one stream in the transaction that turns the
+ *		display on, so the panel never shows its RAM garbage. The drawing state starts from the
+ *		back color with nothing left to update; a splash stays on the panel until it is drawn
+ *		over (the RGB565 frame buffer keeps a copy of it)
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
  *	@retval none
  */
-void Display_Command( struct SSD1351 * display, uint8_t command )
+static void Display_FirstFrame( struct SSD1351 * display )
 {
-	GPIO_SetPin(display->dcPinPort, display->dcPin, 0);	/* Set command-mode (DC = 0) */
+#if DISPLAY_INDEXED
+	uint16_t color = display->palette[DISPLAY_INDEX_BYTE(display->currentBackColor) & ((1 << DISPLAY_BUFFER_BPP) - 1)];
+#else
+	uint16_t color = display->currentBackColor;
+#endif
 
-	GPIO_SetPin(display->csPinPort, display->csPin, 0);	/* Select display (CS = 0) */
+#if DISPLAY_HAS_UPD
+	Display_Fill(display, display->currentBackColor);	/* Frame buffer or display list of the cleared screen */
+	display->dirtyCount = 0;				/* that the panel gets below */
+#endif
 
-#if defined(DISPLAY_USE_HW_4SPI)
+#if DISPLAY_HAS_BLEND
+	if(display->splash) memcpy(display->frameBuffer, display->splash, FRAME_BUFFER_SIZE);
+#endif
 
-	SPI_TransmitByte(display->spi, command );	/* Send command byte */
+	Display_Begin(display);
 
-#elif defined(DISPLAY_USE_SW_SPI)
+	display->transport->command(display, 0x15, (const uint8_t []){ 0x00, DISPLAY_WIDTH - 1 }, 2);	/* Whole display RAM */
+	display->transport->command(display, 0x75, (const uint8_t []){ 0x00, DISPLAY_HEIGHT - 1 }, 2);
+	display->transport->command(display, 0x5C, NULL, 0);
 
-	swSpiWrite( display, command );
+	if(display->splash) display->transport->writePixels(display, display->splash, (uint32_t)DISPLAY_WIDTH * DISPLAY_HEIGHT);
+	else display->transport->writeRepeat(display, color, (uint32_t)DISPLAY_WIDTH * DISPLAY_HEIGHT);
 
-#endif
+	display->transport->command(display, 0xAF, NULL, 0);	/* Turn display on */
 
-	GPIO_SetPin(display->csPinPort, display->csPin, 1);	/* Unselect display */
+	Display_End(display);
+
+	DISPLAY_STAT_ADD(display, zones, 1);
+	DISPLAY_STAT_ADD(display, commands, 4);
+	DISPLAY_STAT_ADD(display, dataBytes, 4 + (uint32_t)DISPLAY_WIDTH * DISPLAY_HEIGHT * 2);
 }
 
 
 /*
- * 	@brief 	Send data to display
+ *	@brief 	Initialize display
+ *		Initialization is carried out in 4 stages:
+ * 		1) GPIO initialization
+ * 		2) SPI/I2C initialization,
+ * 		3) Replay the panel setup sequence (display->initSequence) in one transaction
+ * 		4) Set display in default mode, send the first frame (display->splash or the
+ * 		   back color) and turn the display on
  * 
  *	@param	Ptr to the SSD1351 struct
- *	@param 	data to send
  * 
  *	@retval none
  */
-void Display_Data( struct SSD1351 * display, uint8_t data )
+void Display_Init( struct SSD1351 * display )
 {
-	GPIO_SetPin(display->dcPinPort, display->dcPin, 1);	/* Set data-mode  (DC = 1) */
+#if DISPLAY_HAS_UPD || defined(DISPLAY_USE_SPRITES)
+	uint16_t i;
+#endif
+#if defined(DISPLAY_USE_STATS)
+	uint32_t start;
+#endif
 
-	GPIO_SetPin(display->csPinPort, display->csPin, 0);	/* Select display (CS = 0) */
+	Display_PortClockOn(display->csPinPort);	/* Enable GPIO */
+	Display_PortClockOn(display->dcPinPort);
+	Display_PortClockOn(display->resPinPort);
+	Display_PortClockOn(display->clkPinPort);
+	Display_PortClockOn(display->dataPinPort);
 
-#if defined(DISPLAY_USE_HW_4SPI)
+#if DISPLAY_HAS_UPD
+	display->updQueued = 0;
 
-	SPI_TransmitByte(display->spi, data);	/* Send data byte */
+	if(display->bus)	/* Join the shared bus once */
+	{
+		for(i = 0; i < display->bus->count && display->bus->displays[i] != display; i++);
 
-#elif defined(DISPLAY_USE_SW_SPI)
+		if(i == display->bus->count && i < DISPLAY_BUS_DISPLAYS) display->bus->displays[display->bus->count++] = display;
+	}
+#endif
 
-	swSpiWrite(display, data);
+#if defined(DISPLAY_USE_STATS)
+#if !defined(LIB2F4_HOST)
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;	/* Start the cycle counter used by the statistics */
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+	start = DISPLAY_CYCLES();
 #endif
 
-	GPIO_SetPin(display->csPinPort, display->csPin, 1);	/* Unselect display */
-}
+	if(display->transport == NULL)	/* Transport of the configuration */
+	{
+#if defined(DISPLAY_USE_DMA)
+		display->transport = &Display_DmaSpiTransport;
+#elif defined(DISPLAY_USE_HW_4SPI)
+		display->transport = &Display_HwSpiTransport;
+#elif defined(DISPLAY_USE_SW_4SPI)
+		display->transport = &Display_SwSpiTransport;
+#endif
+	}
 
+	if(display->transport->init) display->transport->init(display);	/* Enable SPI or the CLK and DATA outputs */
 
-/*
- * 	@brief 	Adjust the output zone
- *		Move the display RAM pointer to the beginning of the rectangle 
- * 
- * 	@param	Ptr to the SSD1351 struct
- *  @param	rectangle leftmost x
- *	@param	rectangle topmost y
- *	@param	rectangle width
- *	@param	rectangle height
- * 
- *	@retval none
- */
-void Display_SetDrawZone( struct SSD1351 * display, uint8_t x0, uint8_t y0, uint8_t width, uint8_t height )
-{
-	uint16_t x1, y1;
+	GPIO_InitPin(display->csPinPort, display->csPin, GPIO_MODE_OUTPUT | GPIO_OSPEED_50MHZ);
+	GPIO_InitPin(display->dcPinPort, display->dcPin, GPIO_MODE_OUTPUT | GPIO_OSPEED_50MHZ);
+	GPIO_InitPin(display->resPinPort, display->resPin, GPIO_MODE_OUTPUT | GPIO_OSPEED_50MHZ);
 
-	if(x0 > DISPLAY_WIDTH || y0 > DISPLAY_HEIGHT) return;
+	//GPIO_configPin(display->csPinPort, display->csPin, GPIO_OUTPUT_PUSH_PULL);	/* Set CS, DC, RES as output */
+	//GPIO_configPin(display->dcPinPort, display->dcPin, GPIO_OUTPUT_PUSH_PULL);
+	//GPIO_configPin(display->resPinPort, display->resPin, GPIO_OUTPUT_PUSH_PULL);
 
-	x1 = x0 + width - 1;
-	y1 = y0 + height - 1;
+	GPIO_SetPin(display->csPinPort, display->csPin, 1);		/* Unselect display (CS = 1) */
+	GPIO_SetPin(display->resPinPort, display->resPin, 0);	/* Reset display (RES = 0) */
 
-	if(x1 > DISPLAY_WIDTH || y1 > DISPLAY_HEIGHT) return;
+	_delay_ms(1);	/* RES low for at least 2 us */
 
-	Display_Command(display, 0x15); /* set column */
-	Display_Data(display, x0);
-	Display_Data(display, x1);
+	GPIO_SetPin(display->resPinPort, display->resPin, 1);	/* End reset (RES = 1) */
 
-	Display_Command(display, 0x75); /* set row*/
-	Display_Data(display, y0);
-	Display_Data(display, y1);
+	Display_RunSequence(display, display->initSequence ? display->initSequence : Display_InitSequence);
 
-	Display_Command(display, 0x5C); /* enable display RAM output */
-}
+#if DISPLAY_INDEXED
+	memset(display->palette, 0, sizeof(display->palette));
+	memcpy(display->palette, defaultPalette, sizeof(defaultPalette) < sizeof(display->palette) ? sizeof(defaultPalette) : sizeof(display->palette));
 
-#if DISPLAY_HAS_BUFFER
-void Display_Upd(struct SSD1351 *display)
-{
-	uint32_t i;
+	Display_SetBackColor(display, DISPLAY_DEFAULT_BACK_INDEX);	/* Default color settings */
+	Display_SetDrawColor(display, DISPLAY_DEFAULT_DRAW_INDEX);
+#else
+	Display_SetBackColor(display, DISPLAY_DEFAULT_BACK_COLOR);	/* Default color settings */
+	Display_SetDrawColor(display, DISPLAY_DEFAULT_DRAW_COLOR);
+#endif
 
-	Display_SetDrawZone(display, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+	Display_SetDrawMode(display, DISPLAY_DEFAULT_DRAW_MODE);
+	Display_SetAlpha(display, 255);
+
+	display->clip = (struct Display_Rect){ 0, 0, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1 };	/* Whole screen, set before the list is started */
+	display->originX = 0;
+	display->originY = 0;
+
+	display->startLine = 0;		/* Scroll state set by the control bytes above */
+	display->lineOffset = 0;
+	display->scrollY = 0;
+	display->inverse = 0;
+	display->hScrollHeight = 0;
+
+#if defined(DISPLAY_USE_BANDS)
+	display->bandRows = 0;
+	display->listPartial = 0;
+	display->dirtyCount = 0;
+#endif
 
-	GPIO_SetPin(display->dcPinPort, display->dcPin, 1);
-	GPIO_SetPin(display->csPinPort, display->csPin, 0);
+#if defined(DISPLAY_USE_CONSOLE)
+	memset(&display->console, 0, sizeof(display->console));	/* Empty console, cursor at the top left cell */
+#endif
 
-	display->spi->CR1 |= SPI_CR1_DFF;
+#if defined(DISPLAY_USE_SPRITES)
+	memset(display->sprites, 0, sizeof(display->sprites));	/* Empty pool, nothing shown */
 
-	for(i = 0; i < FRAME_BUFFER_SIZE / 2; i++)
+	for(i = 0; i < DISPLAY_SPRITES; i++)
 	{
-		//SPI_TransmitByte(display->spi, display->frameBuffer[i]);
-		display->spi->DR = ((volatile uint16_t *)&display->frameBuffer)[i];
-		while(!(display->spi->SR & SPI_SR_TXE));
+		display->sprites[i].shown = (struct Display_Rect){ 1, 1, 0, 0 };
 	}
 
-	display->spi->CR1 &= ~SPI_CR1_DFF;
+	display->spriteBackground = NULL;
+#endif
+
+	Display_FirstFrame(display);
 
-	GPIO_SetPin(display->csPinPort, display->csPin, 0);
-}
+#if defined(DISPLAY_USE_STATS)
+	display->stats.initCycles = DISPLAY_CYCLES() - start;
 #endif
+}
+
+
+#if defined(DISPLAY_USE_HW_4SPI)
 
 /*
- *	@brief	Clear display
- *		The display is filled with the color specified in the SSD1351->currentBackColor (black by default)
- * 
- *	@note	frequent use slows down the display greatly
- * 
+ *	@brief	Put one frame into the SPI transmitter
+ *		Returns as soon as the frame is accepted, call Display_SpiWaitIdle before touching DC or CS
+ *
  *	@param	Ptr to the SSD1351 struct
- * 
+ *	@param	Byte to send
+ *
  *	@retval none
  */
-void Display_Clear(struct SSD1351 *display)
+static inline void Display_SpiPut( struct SSD1351 * display, uint8_t value )
 {
-	uint32_t i;
-
-#if DISPLAY_HAS_BUFFER
-	for(i = 0; i < FRAME_BUFFER_SIZE; i++)
-	{
-		display->frameBuffer[i] = 0;
-	}
-#else
-	uint8_t color8a = (display->currentBackColor >> 8);		/* Get last byte of color code */
-	uint8_t color8b	= (display->currentBackColor & 0xff);	/* Get first byte of color code */
-
-	Display_SetDrawZone(display, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
-
-	for(i = 0; i < DISPLAY_RAM_SIZE; i++)
-	{
-		Display_Data(display, color8a);		/* Send first byte of color code */
-		Display_Data(display, color8b);		/* Send last byte of color code */
-	}
-#endif
+	while(!(display->spi->SR & SPI_SR_TXE));
+	DISPLAY_SPI_WRITE(display->spi, value);
 }
 
 
 /*
- *	@brief Fill display with selected color
- * 
- *	@param Ptr to th SSD1351 struct
- *	@param fill color
- * 
+ *	@brief	Put one 16 bit word into the SPI transmitter, most significant byte first
+ *		The unit has to be switched to 16 bit frames by Display_SpiWordMode
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Word to send
+ *
  *	@retval none
  */
-void Display_Fill( struct SSD1351 * display, uint16_t color )
+static inline void Display_SpiPut16( struct SSD1351 * display, uint16_t value )
 {
-	uint16_t i;
-
-	uint32_t color32 = color + ((uint32_t)color << 16);
-
-	for(i = 0; i < FRAME_BUFFER_SIZE /  4; i++)
-	{
-		((uint32_t *)&display->frameBuffer)[i] = color32;
-	}
+	while(!(display->spi->SR & SPI_SR_TXE));
+	DISPLAY_SPI_WRITE(display->spi, value);
 }
 
 
 /*
- *	@brief	Set display draw color
- * 
+ *	@brief	Wait until the last frame left the SPI shift register
+ *
  *	@param	Ptr to the SSD1351 struct
- *	@param	New draw color
- * 
+ *
  *	@retval none
  */
-void Display_SetDrawColor(struct SSD1351 *display, uint16_t color)
+static void Display_SpiWaitIdle( struct SSD1351 * display )
 {
-	display->currentDrawColor = color;
+	while(!(display->spi->SR & SPI_SR_TXE));
+	while(display->spi->SR & SPI_SR_BSY);
 }
 
 
 /*
- *	@brief	Set display background color
- * 
+ *	@brief	Switch SPI frame format between 8 and 16 bits
+ *		DFF may only be changed while the SPI unit is disabled
+ *
  *	@param	Ptr to the SSD1351 struct
- *	@param	New background color
- * 
+ *	@param	0 - 8 bit frames, 1 - 16 bit frames
+ *
  *	@retval none
  */
-void Display_SetBackColor(struct SSD1351 *display, uint16_t color)
+static void Display_SpiWordMode( struct SSD1351 * display, uint8_t enable )
 {
-	display->currentBackColor = color;
+	display->spi->CR1 &= ~SPI_CR1_SPE;
+
+	if(enable)
+	{
+		display->spi->CR1 |= SPI_CR1_DFF;
+	}
+	else
+	{
+		display->spi->CR1 &= ~SPI_CR1_DFF;
+	}
+
+	display->spi->CR1 |= SPI_CR1_SPE;
 }
 
 
 /*
- *	@brief	Set display xbm mode.
- *		If mode != 0, then the empty XBM sections will overlap the previously displayed pixel
- * 
+ *	@brief	Set DC and the frame format for the next frames of a transaction
+ *		Either is changed only when it differs, after the frames before are sent.
+ *		The frame format is read back from the unit, it may be shared by several displays
+ *
  *	@param	Ptr to the SSD1351 struct
- *	@param	New XBM mode
- * 
- *	@retval	none
+ *	@param	0 - command mode, 1 - data mode
+ *	@param	0 - 8 bit frames, 1 - 16 bit frames
+ *
+ *	@retval none
  */
-void Display_SetDrawMode(struct SSD1351 *display, uint8_t mode)
+static void Display_SpiMode( struct SSD1351 * display, uint8_t dataMode, uint8_t words )
 {
-	display->drawMode = mode;
+	uint8_t wordMode = (display->spi->CR1 & SPI_CR1_DFF) ? 1 : 0;
+
+	if(wordMode == words && GPIO_GetPin(display->dcPinPort, display->dcPin) == dataMode) return;
+
+	Display_SpiWaitIdle(display);
+
+	GPIO_SetPin(display->dcPinPort, display->dcPin, dataMode);
+
+	if(wordMode != words) Display_SpiWordMode(display, words);
 }
 
 
 /*
- *	@brief	Draw pixel
- * 
+ *	@brief	Enable the SPI unit of the display and route CLK and DATA to it
+ *
  *	@param	Ptr to the SSD1351 struct
- *	@param	Pixel x coordinate
- *	@param	Pixel y coordinate
- *	@param	Pixel color
- * 
+ *
  *	@retval none
  */
-void Display_DrawPixel(struct SSD1351 *display, uint8_t x, uint8_t y, uint16_t color)
+static void Display_HwSpiInit( struct SSD1351 * display )
 {
-	if(x > DISPLAY_WIDTH - 1 || y > DISPLAY_HEIGHT - 1) return;
+	uint8_t altFunc = Display_SpiClockOn(display);	/* Enable SPI */
 
-	Display_SetDrawZone(display, x, y, 1, 1);
+	GPIO_InitPin(display->clkPinPort, display->clkPin, GPIO_MODE_ALT); /* Set CLK as alternate output */
+	GPIO_InitPin(display->dataPinPort, display->dataPin, GPIO_MODE_ALT); /* Set DATA as alternate output */
 
-#if DISPLAY_HAS_BUFFER
-	((uint16_t*)&display->frameBuffer)[DISPLAY_WIDTH * y + x] = color;
+	GPIO_SetAltMode(display->clkPinPort, display->clkPin, altFunc);
+	GPIO_SetAltMode(display->dataPinPort, display->dataPin, altFunc);
+
+	display->spi->CR1 |= SPI_CR1_MSTR | SPI_CR1_SSI | SPI_CR1_SSM | SPI_CR1_SPE | SPI_CR1_BR_0; /* Init SPI as master */
+}
 
-#else
-	Display_Data(display, color >> 8);
-	Display_Data(display, color & 0x00FF );
-#endif
 
+/*
+ *	@brief	Select the display
+ */
+static void Display_HwSpiBegin( struct SSD1351 * display )
+{
+	GPIO_SetPin(display->csPinPort, display->csPin, 0);	/* Select display (CS = 0) */
 }
 
-void Display_DrawLine(struct SSD1351 *display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+
+/*
+ *	@brief	Wait until the last frame is sent and unselect the display
+ */
+static void Display_HwSpiEnd( struct SSD1351 * display )
 {
-	int16_t deltaX = abs(x0 - x1);
-	int16_t deltaY = abs(y0 - y1);
+	Display_SpiWaitIdle(display);
+	GPIO_SetPin(display->csPinPort, display->csPin, 1);	/* Unselect display */
+}
 
-	int16_t signX = x0 < x1 ? 1 : -1;
-	int16_t signY = y0 < y1 ? 1 : -1;
 
-	int16_t error = deltaX - deltaY;
+/*
+ *	@brief	Send a command byte, then its parameters as data
+ */
+static void Display_HwSpiCommand( struct SSD1351 * display, uint8_t command, const uint8_t * data, uint16_t length )
+{
+	Display_SpiMode(display, 0, 0);
+	Display_SpiPut(display, command);
+
+	if(length == 0) return;
 
-	Display_DrawPixel(display, x1, y1, display->currentDrawColor);
+	Display_SpiMode(display, 1, 0);
 
-	while(x0 != x1 || y0 != y1)
+	while(length--)
 	{
-		Display_DrawPixel(display, x0, y0, display->currentDrawColor);
-		int error2 = error * 2;
-		if(error2 > -deltaY)
-		{
-			error -= deltaY;
-			x0 += signX;
-		}
-		if(error2 < deltaX)
-		{
-			error += deltaX;
-			y0 += signY;
-		}
+		Display_SpiPut(display, *data++);
 	}
 }
 
 
 /*
- *	@brief	Draw ASCII char
- * 
- *	@param	Ptr to the SSD1351 struct
- *	@param	Char x coordinate
- *	@param	Char y coordinate
- *	@param	ASCII char
+ *	@brief	Send data bytes in 8 bit frames
+ */
+static void Display_HwSpiWrite( struct SSD1351 * display, const uint8_t * data, uint32_t length )
+{
+	Display_SpiMode(display, 1, 0);
+
+	while(length--)
+	{
+		Display_SpiPut(display, *data++);
+	}
+}
+
+
+/*
+ *	@brief	Send RGB565 pixels in 16 bit frames
+ */
+static void Display_HwSpiWritePixels( struct SSD1351 * display, const uint16_t * pixels, uint32_t count )
+{
+	Display_SpiMode(display, 1, 1);	/* One 16 bit frame per pixel */
+
+	while(count--)
+	{
+		Display_SpiPut16(display, *pixels++);
+	}
+}
+
+
+/*
+ *	@brief	Send one RGB565 color count times in 16 bit frames
+ */
+static void Display_HwSpiWriteRepeat( struct SSD1351 * display, uint16_t color, uint32_t count )
+{
+	Display_SpiMode(display, 1, 1);
+
+	while(count--)
+	{
+		Display_SpiPut16(display, color);
+	}
+}
+
+
+const struct Display_Transport Display_HwSpiTransport =
+{
+	Display_HwSpiInit, Display_HwSpiBegin, Display_HwSpiEnd, Display_HwSpiCommand,
+	Display_HwSpiWrite, Display_HwSpiWritePixels, Display_HwSpiWriteRepeat, NULL
+};
+
+#endif /* DISPLAY_USE_HW_4SPI */
+
+
+#if defined(DISPLAY_USE_SW_4SPI)
+
+/*
+ *	@brief	BSRR words of the software SPI pins, worked out once per transport call
+ */
+struct Display_SwPins
+{
+	GPIO_TypeDef *clk;
+	GPIO_TypeDef *data;
+	uint32_t clkSet;	/* CLK rising edge */
+	uint32_t clkReset;	/* CLK low */
+	uint32_t level[2];	/* DATA low, DATA high. CLK falls in the same write when both pins share a port */
+};
+
+/* One bit of the shared port path: DATA and the falling CLK edge, then the rising edge the display samples on */
+#define DISPLAY_SW_CLOCK(port, word, clkSet) \
+	do { \
+		DISPLAY_GPIO_BSRR((port), (word)); \
+		DISPLAY_SW_SPI_HOLD(); \
+		DISPLAY_GPIO_BSRR((port), (clkSet)); \
+		DISPLAY_SW_SPI_HOLD(); \
+	} while(0)
+
+#define DISPLAY_SW_BIT(port, level, clkSet, value, n)	DISPLAY_SW_CLOCK((port), (level)[((value) >> (n)) & 1], (clkSet))
+
+
+/*
+ *	@brief	Work out the BSRR words of the CLK and DATA pins
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Destination
+ *
+ *	@retval none
+ */
+static void Display_SwSpiPins( struct SSD1351 * display, struct Display_SwPins * pins )
+{
+	pins->clk = display->clkPinPort;
+	pins->data = display->dataPinPort;
+	pins->clkSet = 1UL << display->clkPin;
+	pins->clkReset = 1UL << (display->clkPin + 16);
+	pins->level[0] = 1UL << (display->dataPin + 16);
+	pins->level[1] = 1UL << display->dataPin;
+
+	if(pins->clk == pins->data)
+	{
+		pins->level[0] |= pins->clkReset;
+		pins->level[1] |= pins->clkReset;
+	}
+}
+
+
+/*
+ *	@brief	Shift one byte out on the DATA pin, most significant bit first
+ *		SPI mode 0: DATA changes while CLK is low, the display samples it on the rising edge.
+ *		CLK stays high after the last bit, the next bit or the end of the transaction pulls it low.
+ *		With CLK and DATA on one port every bit takes two BSRR writes, the loop is unrolled
+ *
+ *	@param	Pins
+ *	@param	Byte to send
+ *
+ *	@retval none
+ */
+static void Display_SwSpiByte( const struct Display_SwPins * pins, uint8_t value )
+{
+	GPIO_TypeDef *port = pins->clk;
+	const uint32_t *level = pins->level;
+	uint32_t clkSet = pins->clkSet;
+	uint8_t bit;
+
+	if(pins->clk == pins->data)
+	{
+		DISPLAY_SW_BIT(port, level, clkSet, value, 7);
+		DISPLAY_SW_BIT(port, level, clkSet, value, 6);
+		DISPLAY_SW_BIT(port, level, clkSet, value, 5);
+		DISPLAY_SW_BIT(port, level, clkSet, value, 4);
+		DISPLAY_SW_BIT(port, level, clkSet, value, 3);
+		DISPLAY_SW_BIT(port, level, clkSet, value, 2);
+		DISPLAY_SW_BIT(port, level, clkSet, value, 1);
+		DISPLAY_SW_BIT(port, level, clkSet, value, 0);
+		return;
+	}
+
+	for(bit = 8; bit--; )	/* CLK and DATA on two ports: three writes per bit */
+	{
+		DISPLAY_GPIO_BSRR(port, pins->clkReset);
+		DISPLAY_GPIO_BSRR(pins->data, level[(value >> bit) & 1]);
+		DISPLAY_SW_SPI_HOLD();
+		DISPLAY_GPIO_BSRR(port, clkSet);
+		DISPLAY_SW_SPI_HOLD();
+	}
+}
+
+
+/*
+ *	@brief	Drive CLK and DATA as outputs, CLK low
+ */
+static void Display_SwSpiInit( struct SSD1351 * display )
+{
+	GPIO_InitPin(display->clkPinPort, display->clkPin, GPIO_MODE_OUTPUT | GPIO_OSPEED_50MHZ);	/* Set CLK as output */
+	GPIO_InitPin(display->dataPinPort, display->dataPin, GPIO_MODE_OUTPUT | GPIO_OSPEED_50MHZ);	/* Set DATA as output */
+
+	GPIO_SetPin(display->clkPinPort, display->clkPin, 0);
+}
+
+
+/*
+ *	@brief	Select the display
+ */
+static void Display_SwSpiBegin( struct SSD1351 * display )
+{
+	GPIO_SetPin(display->csPinPort, display->csPin, 0);	/* Select display (CS = 0) */
+}
+
+
+/*
+ *	@brief	Return CLK to idle and unselect the display
+ */
+static void Display_SwSpiEnd( struct SSD1351 * display )
+{
+	GPIO_SetPin(display->clkPinPort, display->clkPin, 0);
+	GPIO_SetPin(display->csPinPort, display->csPin, 1);
+}
+
+
+/*
+ *	@brief	Send a command byte, then its parameters as data
+ */
+static void Display_SwSpiCommand( struct SSD1351 * display, uint8_t command, const uint8_t * data, uint16_t length )
+{
+	struct Display_SwPins pins;
+
+	Display_SwSpiPins(display, &pins);
+
+	GPIO_SetPin(display->dcPinPort, display->dcPin, 0);
+	Display_SwSpiByte(&pins, command);
+
+	if(length == 0) return;
+
+	GPIO_SetPin(display->dcPinPort, display->dcPin, 1);
+
+	while(length--)
+	{
+		Display_SwSpiByte(&pins, *data++);
+	}
+}
+
+
+/*
+ *	@brief	Send data bytes
+ */
+static void Display_SwSpiWrite( struct SSD1351 * display, const uint8_t * data, uint32_t length )
+{
+	struct Display_SwPins pins;
+
+	Display_SwSpiPins(display, &pins);
+
+	GPIO_SetPin(display->dcPinPort, display->dcPin, 1);
+
+	while(length--)
+	{
+		Display_SwSpiByte(&pins, *data++);
+	}
+}
+
+
+/*
+ *	@brief	Send RGB565 pixels, most significant byte first
+ *		Pixel streams shift out all 16 bits of a word in one unrolled run
+ */
+static void Display_SwSpiWritePixels( struct SSD1351 * display, const uint16_t * pixels, uint32_t count )
+{
+	struct Display_SwPins pins;
+	GPIO_TypeDef *port;
+	uint32_t clkSet;
+	uint16_t value;
+
+	Display_SwSpiPins(display, &pins);
+
+	GPIO_SetPin(display->dcPinPort, display->dcPin, 1);
+
+	if(pins.clk != pins.data)
+	{
+		for(; count; count--, pixels++)
+		{
+			Display_SwSpiByte(&pins, *pixels >> 8);
+			Display_SwSpiByte(&pins, *pixels & 0xFF);
+		}
+
+		return;
+	}
+
+	port = pins.clk;
+	clkSet = pins.clkSet;
+
+	while(count--)
+	{
+		value = *pixels++;
+
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 15);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 14);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 13);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 12);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 11);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 10);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 9);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 8);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 7);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 6);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 5);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 4);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 3);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 2);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 1);
+		DISPLAY_SW_BIT(port, pins.level, clkSet, value, 0);
+	}
+}
+
+
+/*
+ *	@brief	Send one RGB565 color count times
+ *		The 16 DATA words of the color are worked out once, each pixel is then only the BSRR writes
+ */
+static void Display_SwSpiWriteRepeat( struct SSD1351 * display, uint16_t color, uint32_t count )
+{
+	struct Display_SwPins pins;
+	GPIO_TypeDef *port;
+	uint32_t word[16];
+	uint32_t clkSet;
+	uint8_t i;
+
+	Display_SwSpiPins(display, &pins);
+
+	GPIO_SetPin(display->dcPinPort, display->dcPin, 1);
+
+	if(pins.clk != pins.data)
+	{
+		while(count--)
+		{
+			Display_SwSpiByte(&pins, color >> 8);
+			Display_SwSpiByte(&pins, color & 0xFF);
+		}
+
+		return;
+	}
+
+	for(i = 0; i < 16; i++)
+	{
+		word[i] = pins.level[(color >> (15 - i)) & 1];
+	}
+
+	port = pins.clk;
+	clkSet = pins.clkSet;
+
+	while(count--)
+	{
+		DISPLAY_SW_CLOCK(port, word[0], clkSet);
+		DISPLAY_SW_CLOCK(port, word[1], clkSet);
+		DISPLAY_SW_CLOCK(port, word[2], clkSet);
+		DISPLAY_SW_CLOCK(port, word[3], clkSet);
+		DISPLAY_SW_CLOCK(port, word[4], clkSet);
+		DISPLAY_SW_CLOCK(port, word[5], clkSet);
+		DISPLAY_SW_CLOCK(port, word[6], clkSet);
+		DISPLAY_SW_CLOCK(port, word[7], clkSet);
+		DISPLAY_SW_CLOCK(port, word[8], clkSet);
+		DISPLAY_SW_CLOCK(port, word[9], clkSet);
+		DISPLAY_SW_CLOCK(port, word[10], clkSet);
+		DISPLAY_SW_CLOCK(port, word[11], clkSet);
+		DISPLAY_SW_CLOCK(port, word[12], clkSet);
+		DISPLAY_SW_CLOCK(port, word[13], clkSet);
+		DISPLAY_SW_CLOCK(port, word[14], clkSet);
+		DISPLAY_SW_CLOCK(port, word[15], clkSet);
+	}
+}
+
+
+const struct Display_Transport Display_SwSpiTransport =
+{
+	Display_SwSpiInit, Display_SwSpiBegin, Display_SwSpiEnd, Display_SwSpiCommand,
+	Display_SwSpiWrite, Display_SwSpiWritePixels, Display_SwSpiWriteRepeat, NULL
+};
+
+#endif /* DISPLAY_USE_SW_4SPI */
+
+
+#if defined(DISPLAY_USE_DMA)
+
+/*
+ *	@brief	Wait until no other display sends an update over the shared bus
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+static void Display_BusAcquire( struct SSD1351 * display )
+{
+	struct SSD1351 *owner;
+
+	if(display->bus == NULL) return;
+
+	while((owner = display->bus->owner) != NULL && owner != display)
+	{
+		Display_WaitUpd(owner);
+	}
+}
+
+#endif
+
+
+/*
+ *	@brief	Start a transaction on the transport of the display
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+static void Display_Begin( struct SSD1351 * display )
+{
+#if defined(DISPLAY_USE_DMA)
+	Display_WaitUpd(display);	/* DC, CS and DR must not change under a running transfer */
+	Display_BusAcquire(display);
+#endif
+
+	display->transport->begin(display);
+}
+
+
+/*
+ *	@brief	Finish a transaction: wait for the last frame and unselect the display
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+static void Display_End( struct SSD1351 * display )
+{
+	display->transport->end(display);
+}
+
+
+/*
+ *	@brief	Send a command with its parameters in one transaction
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Command byte
+ *	@param	Parameter bytes, may be NULL if length is 0
+ *	@param	Number of parameter bytes
+ *
+ *	@retval none
+ */
+void Display_WriteCommand(struct SSD1351 *display, uint8_t command, const uint8_t *data, uint16_t length)
+{
+	Display_Begin(display);
+	display->transport->command(display, command, data, length);
+	Display_End(display);
+
+	DISPLAY_STAT_ADD(display, commands, 1);
+	DISPLAY_STAT_ADD(display, dataBytes, length);
+}
+
+
+/*
+ *	@brief	Stream data bytes (e.g. pixels after 0x5C) in one transaction
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Data bytes
+ *	@param	Number of bytes
+ *
+ *	@retval none
+ */
+void Display_WriteData(struct SSD1351 *display, const uint8_t *data, uint32_t length)
+{
+	Display_Begin(display);
+	display->transport->write(display, data, length);
+	Display_End(display);
+
+	DISPLAY_STAT_ADD(display, dataBytes, length);
+}
+
+
+/*
+ *	@brief	Send the same 16 bit color count times in one transaction
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	RGB565 color
+ *	@param	Number of pixels
+ *
+ *	@retval none
+ */
+void Display_WriteColor(struct SSD1351 *display, uint16_t color, uint32_t count)
+{
+	DISPLAY_STAT_ADD(display, dataBytes, count * 2);
+
+	Display_Begin(display);
+	display->transport->writeRepeat(display, color, count);
+	Display_End(display);
+}
+
+
+/*
+ *	@brief	Count the screen rows a draw zone can cover before the display RAM wraps
+ *		Screen row y lives in RAM row (y + scrollY) % DISPLAY_HEIGHT, so once the start
+ *		line moved a zone may have to be split in two
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Topmost screen row
+ *	@param	Rows wanted
+ *
+ *	@retval	Rows that fit in one draw zone (1..height)
+ */
+static uint8_t Display_ZoneRows( struct SSD1351 * display, uint8_t y, uint8_t height )
+{
+	uint8_t rows = DISPLAY_HEIGHT - (y + display->scrollY) % DISPLAY_HEIGHT;
+
+	return height < rows ? height : rows;
+}
+
+
+/*
+ *	@brief	Send the draw zone commands in the open transaction
+ *		The rectangle is checked by the caller
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	rectangle leftmost x
+ *	@param	rectangle topmost y (screen row)
+ *	@param	rectangle width
+ *	@param	rectangle height
+ *
+ *	@retval none
+ */
+static void Display_ZoneCommands( struct SSD1351 * display, uint8_t x0, uint8_t y0, uint8_t width, uint8_t height )
+{
+	y0 = (y0 + display->scrollY) % DISPLAY_HEIGHT;	/* Screen row to RAM row */
+
+	display->transport->command(display, 0x15, (const uint8_t []){ x0, (uint8_t)(x0 + width - 1) }, 2); /* set column */
+	display->transport->command(display, 0x75, (const uint8_t []){ y0, (uint8_t)(y0 + height - 1) }, 2); /* set row*/
+	display->transport->command(display, 0x5C, NULL, 0); /* enable display RAM output */
+
+	DISPLAY_STAT_ADD(display, zones, 1);
+	DISPLAY_STAT_ADD(display, commands, 3);
+	DISPLAY_STAT_ADD(display, dataBytes, 4);
+}
+
+
+#if !DISPLAY_HAS_BUFFER	/* Drawing calls that go straight to the display */
+
+/*
+ * 	@brief 	Adjust the output zone
+ *		Move the display RAM pointer to the beginning of the rectangle.
+ *		Rows are screen rows, the rectangle must not cross the RAM wrap (see Display_ZoneRows)
+ * 
+ * 	@param	Ptr to the SSD1351 struct
+ *  @param	rectangle leftmost x
+ *	@param	rectangle topmost y
+ *	@param	rectangle width
+ *	@param	rectangle height
+ * 
+ *	@retval none
+ */
+static void Display_SetDrawZone( struct SSD1351 * display, uint8_t x0, uint8_t y0, uint8_t width, uint8_t height )
+{
+	if(x0 >= DISPLAY_WIDTH || y0 >= DISPLAY_HEIGHT || width == 0 || height == 0) return;
+
+	if(width > DISPLAY_WIDTH - x0 || height > DISPLAY_HEIGHT - (y0 + display->scrollY) % DISPLAY_HEIGHT) return;
+
+	Display_Begin(display);	/* Whole setup goes in one transaction */
+	Display_ZoneCommands(display, x0, y0, width, height);
+	Display_End(display);
+}
+
+#endif
+
+#if DISPLAY_HAS_UPD
+
+#define DISPLAY_ZONE_OVERHEAD	7	/* Bytes spent on Display_SetDrawZone: 3 commands + 4 coordinates */
+
+/*
+ *	@brief	Add a rectangle to the dirty list of the frame buffer
+ *		The rectangle is merged into an existing one when the union costs no more bus time
+ *		than sending both separately. When the list is full it is merged into the rectangle
+ *		that grows the least.
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Leftmost x
+ *	@param	Topmost y
+ *	@param	Rightmost x (inclusive, < DISPLAY_WIDTH)
+ *	@param	Bottom y (inclusive, < DISPLAY_HEIGHT)
+ *
+ *	@retval none
+ */
+static void Display_MarkDirty( struct SSD1351 * display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1 )
+{
+	struct Display_Rect *rect = display->dirty;
+	struct Display_Rect *best = display->dirty;
+	uint32_t area, unionArea, growth;
+	uint32_t bestGrowth = 0xFFFFFFFF;
+	uint32_t newArea = (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+	uint8_t i;
+
+#if defined(DISPLAY_USE_BANDS)
+	if(display->bandRows) return;	/* Replaying the list */
+#endif
+
+	for(i = 0; i < display->dirtyCount; i++, rect++)
+	{
+		if(x0 >= rect->x0 && x1 <= rect->x1 && y0 >= rect->y0 && y1 <= rect->y1) return;	/* Already dirty */
+
+		area = (uint32_t)(rect->x1 - rect->x0 + 1) * (rect->y1 - rect->y0 + 1);
+
+		unionArea = (uint32_t)((x1 > rect->x1 ? x1 : rect->x1) - (x0 < rect->x0 ? x0 : rect->x0) + 1) *
+				((y1 > rect->y1 ? y1 : rect->y1) - (y0 < rect->y0 ? y0 : rect->y0) + 1);
+
+		growth = unionArea - area;
+
+		if(growth < bestGrowth)
+		{
+			bestGrowth = growth;
+			best = rect;
+		}
+	}
+
+	if(display->dirtyCount < DISPLAY_DIRTY_RECTS && bestGrowth > newArea + DISPLAY_ZONE_OVERHEAD / 2)
+	{
+		rect = &display->dirty[display->dirtyCount++];	/* Separate window is cheaper */
+
+		rect->x0 = x0;
+		rect->y0 = y0;
+		rect->x1 = x1;
+		rect->y1 = y1;
+		return;
+	}
+
+	if(x0 < best->x0) best->x0 = x0;
+	if(y0 < best->y0) best->y0 = y0;
+	if(x1 > best->x1) best->x1 = x1;
+	if(y1 > best->y1) best->y1 = y1;
+}
+
+
+/*
+ *	@brief	Mark a part of the frame buffer as changed
+ *		Use it after writing display->frameBuffer directly (with bands the area is rendered again)
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Rectangle leftmost x
+ *	@param	Rectangle topmost y
+ *	@param	Rectangle width
+ *	@param	Rectangle height
+ *
+ *	@retval none
+ */
+void Display_InvalidateRect(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+	if(x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT || width == 0 || height == 0) return;
+
+	if(width > DISPLAY_WIDTH - x) width = DISPLAY_WIDTH - x;
+	if(height > DISPLAY_HEIGHT - y) height = DISPLAY_HEIGHT - y;
+
+	Display_MarkDirty(display, x, y, x + width - 1, y + height - 1);
+}
+
+
+/*
+ *	@brief	Force the next Display_Upd to send the whole frame buffer
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+void Display_Invalidate(struct SSD1351 *display)
+{
+	display->dirty[0].x0 = 0;
+	display->dirty[0].y0 = 0;
+	display->dirty[0].x1 = DISPLAY_WIDTH - 1;
+	display->dirty[0].y1 = DISPLAY_HEIGHT - 1;
+
+	display->dirtyCount = 1;
+}
+
+
+/*
+ *	@brief	Get the number of bytes the next Display_Upd would send
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval	Pixel data plus draw zone setup bytes of all dirty rectangles
+ */
+uint32_t Display_GetUpdSize(struct SSD1351 *display)
+{
+	const struct Display_Rect *rect = display->dirty;
+	uint32_t size = 0;
+	uint8_t i, height;
+
+	for(i = 0; i < display->dirtyCount; i++, rect++)
+	{
+		height = rect->y1 - rect->y0 + 1;
+
+		size += DISPLAY_ZONE_OVERHEAD;
+		size += (uint32_t)(rect->x1 - rect->x0 + 1) * height * 2;
+
+		if(Display_ZoneRows(display, rect->y0, height) < height) size += DISPLAY_ZONE_OVERHEAD;	/* Split at the RAM wrap */
+	}
+
+	return size;
+}
+
+
+/*
+ *	@brief	Open the draw zone of a dirty rectangle for the pixel data that follows
+ *		The zone starts at the given row and ends at the bottom of the rectangle or at the RAM wrap
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Rectangle to send
+ *	@param	First row of the zone
+ *
+ *	@retval	Last row of the zone
+ */
+static uint8_t Display_UpdOpenWindow( struct SSD1351 * display, const struct Display_Rect * rect, uint8_t row )
+{
+	uint8_t rows = Display_ZoneRows(display, row, rect->y1 - row + 1);
+
+	Display_End(display);
+
+	display->transport->begin(display);	/* The update holds the bus, Display_Begin would wait for it */
+	Display_ZoneCommands(display, rect->x0, row, rect->x1 - rect->x0 + 1, rows);
+	display->transport->end(display);
+
+	display->transport->begin(display);
+
+	DISPLAY_STAT_ADD(display, dataBytes, (uint32_t)(rect->x1 - rect->x0 + 1) * rows * 2);	/* Pixels that will follow */
+
+	return row + rows - 1;
+}
+
+
+#if DISPLAY_INDEXED
+
+/*
+ *	@brief	Expand part of a frame buffer row through the palette
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Leftmost x
+ *	@param	Row
+ *	@param	Pixels (x + width <= DISPLAY_WIDTH)
+ *	@param	Destination, RGB565
+ *
+ *	@retval none
+ */
+static void Display_ExpandRow( struct SSD1351 * display, uint8_t x, uint8_t y, uint8_t width, uint16_t * out )
+{
+	const uint16_t *palette = display->palette;
+
+#if DISPLAY_BUFFER_BPP == 8
+	const uint8_t *src = &display->frameBuffer[DISPLAY_ROW_BYTES * y + x];
+
+	while(width--)
+	{
+		*out++ = palette[*src++];
+	}
+#else
+	const uint8_t *src = &display->frameBuffer[DISPLAY_ROW_BYTES * y + x / 2];
+
+	if((x & 1) && width)	/* Odd column is the low nibble */
+	{
+		*out++ = palette[*src++ & 0x0F];
+		width--;
+	}
+
+	for(; width >= 2; width -= 2, src++)
+	{
+		*out++ = palette[*src >> 4];
+		*out++ = palette[*src & 0x0F];
+	}
+
+	if(width) *out = palette[*src >> 4];
+#endif
+}
+
+#endif /* DISPLAY_INDEXED */
+
+
+#if DISPLAY_INDEXED
+
+/*
+ *	@brief	Send a rectangle of the palette frame buffer, blocking
+ *		Rows are expanded to RGB565 one at a time on the way to the transport
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Rectangle to send
+ *
+ *	@retval none
+ */
+static void Display_UpdSendIndexed( struct SSD1351 * display, const struct Display_Rect * rect )
+{
+	uint16_t line[DISPLAY_WIDTH];
+	uint8_t width = rect->x1 - rect->x0 + 1;
+	uint8_t y;
+	uint8_t zoneEnd = Display_UpdOpenWindow(display, rect, rect->y0);
+
+	for(y = rect->y0; y <= rect->y1; y++)
+	{
+		if(y > zoneEnd) zoneEnd = Display_UpdOpenWindow(display, rect, y);	/* Continue past the RAM wrap */
+
+		Display_ExpandRow(display, rect->x0, y, width, line);
+
+		display->transport->writePixels(display, line, width);
+	}
+}
+
+#else
+
+/*
+ *	@brief	Send a rectangle of a pixel buffer, blocking
+ *		Full width rows are contiguous and go to the transport in one write per draw zone
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Rectangle to send
+ *	@param	Buffer row (DISPLAY_WIDTH pixels) that holds the top of the rectangle
+ *
+ *	@retval none
+ */
+static void Display_UpdSendRect( struct SSD1351 * display, const struct Display_Rect * rect, const uint16_t * row )
+{
+	uint8_t width = rect->x1 - rect->x0 + 1;
+	uint8_t y, rows;
+	uint8_t zoneEnd = Display_UpdOpenWindow(display, rect, rect->y0);
+
+	for(y = rect->y0; y <= rect->y1; y += rows, row += rows * DISPLAY_WIDTH)
+	{
+		if(y > zoneEnd) zoneEnd = Display_UpdOpenWindow(display, rect, y);	/* Continue past the RAM wrap */
+
+		rows = width == DISPLAY_WIDTH ? zoneEnd - y + 1 : 1;
+
+		display->transport->writePixels(display, &row[rect->x0], (uint32_t)width * rows);
+	}
+}
+
+#endif /* DISPLAY_INDEXED */
+
+#if defined(DISPLAY_USE_DMA)
+
+static const uint8_t dmaFlagOffset[4] = { 0, 6, 16, 22 };	/* Flag positions of streams 0..3 (4..7) in xISR/xIFCR */
+
+#define DISPLAY_DMA_FLAGS_ALL	(uint32_t)0x3D		/* FEIF | DMEIF | TEIF | HTIF | TCIF */
+#define DISPLAY_DMA_FLAG_TC	(uint32_t)0x20
+
+/*
+ *	@brief	Read interrupt flags of the display DMA stream
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval	Stream flags shifted down to bit 0
+ */
+static uint32_t Display_DmaFlags( struct SSD1351 * display )
+{
+	uint32_t isr = display->dmaStreamNum < 4 ? display->dma->LISR : display->dma->HISR;
+
+	return (isr >> dmaFlagOffset[display->dmaStreamNum & 0x03]) & DISPLAY_DMA_FLAGS_ALL;
+}
+
+
+/*
+ *	@brief	Clear all interrupt flags of the display DMA stream
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+static void Display_DmaClearFlags( struct SSD1351 * display )
+{
+	uint32_t mask = DISPLAY_DMA_FLAGS_ALL << dmaFlagOffset[display->dmaStreamNum & 0x03];
+
+	if(display->dmaStreamNum < 4)
+	{
+		display->dma->LIFCR = mask;
+	}
+	else
+	{
+		display->dma->HIFCR = mask;
+	}
+}
+
+
+/*
+ *	@brief	Start memory-to-SPI transfer of 16 bit pixel data
+ *		Completion raises the stream interrupt, whose handler calls Display_DmaIrqHandler
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Source buffer
+ *	@param	Number of 16 bit words (1..65535)
+ *
+ *	@retval none
+ */
+static void Display_DmaStart( struct SSD1351 * display, const uint16_t * src, uint16_t count )
+{
+	DMA_Stream_TypeDef *stream = display->dmaStream;
+
+	Display_SpiMode(display, 1, 1);
+
+	display->spi->CR2 &= ~SPI_CR2_TXDMAEN;
+
+	stream->CR &= ~DMA_SxCR_EN;
+	while(stream->CR & DMA_SxCR_EN);
+
+	Display_DmaClearFlags(display);
+
+	stream->PAR = (uintptr_t)&display->spi->DR;
+	stream->M0AR = (uintptr_t)src;
+	stream->NDTR = count;
+	stream->FCR = 0;	/* Direct mode */
+
+	stream->CR = ((uint32_t)display->dmaChannel << DMA_SxCR_CHSEL_Pos) |
+			DMA_SxCR_DIR_0 | DMA_SxCR_MINC | DMA_SxCR_MSIZE_0 | DMA_SxCR_PSIZE_0 | DMA_SxCR_TCIE;
+
+	stream->CR |= DMA_SxCR_EN;
+
+	display->spi->CR2 |= SPI_CR2_TXDMAEN;	/* SPI TX request starts the stream */
+}
+
+
+/*
+ *	@brief	Wait until the last frame is sent, release the DMA request and unselect the display
+ */
+static void Display_DmaSpiEnd( struct SSD1351 * display )
+{
+	Display_SpiWaitIdle(display);	/* DMA is done when the last word is loaded, not sent */
+
+	display->spi->CR2 &= ~SPI_CR2_TXDMAEN;
+
+	GPIO_SetPin(display->csPinPort, display->csPin, 1);	/* Unselect display */
+}
+
+
+const struct Display_Transport Display_DmaSpiTransport =
+{
+	Display_HwSpiInit, Display_HwSpiBegin, Display_DmaSpiEnd, Display_HwSpiCommand,
+	Display_HwSpiWrite, Display_HwSpiWritePixels, Display_HwSpiWriteRepeat, Display_DmaStart
+};
+
+
+/*
+ *	@brief	Start the next transfer of the pending update
+ *		Full width rectangles are contiguous in the frame buffer and go in one transfer,
+ *		narrower ones are sent row by row into the same draw zone
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval	0 - nothing left to send, 1 - transfer started
+ */
+static uint8_t Display_DmaNext( struct SSD1351 * display )
+{
+	const struct Display_Rect *rect = &display->updRects[display->updIndex];
+	uint16_t width, rows;
+
+	if(display->updRow > rect->y1)	/* Rectangle is done, move to the next one */
+	{
+		if(++display->updIndex >= display->updCount) return 0;
+
+		rect++;
+		display->updRow = rect->y0;
+		display->updZoneEnd = Display_UpdOpenWindow(display, rect, rect->y0);
+	}
+	else if(display->updRow > display->updZoneEnd)	/* Rest of the rectangle is past the RAM wrap */
+	{
+		display->updZoneEnd = Display_UpdOpenWindow(display, rect, display->updRow);
+	}
+
+	width = rect->x1 - rect->x0 + 1;
+
+#if DISPLAY_INDEXED
+	(void)rows;
+
+	if(!display->updLineReady) Display_ExpandRow(display, rect->x0, display->updRow, width, display->updLine[display->updLineSel]);
+
+	display->transport->writeAsync(display, display->updLine[display->updLineSel], width);
+
+	display->updRow++;
+	display->updLineSel ^= 1;
+	display->updLineReady = 0;
+
+	if(display->updRow <= rect->y1)	/* Expand the next row while this one is sent */
+	{
+		Display_ExpandRow(display, rect->x0, display->updRow, width, display->updLine[display->updLineSel]);
+		display->updLineReady = 1;
+	}
+#else
+	rows = width == DISPLAY_WIDTH ? display->updZoneEnd - display->updRow + 1 : 1;
+
+	display->transport->writeAsync(display, &((const uint16_t *)&display->frameBuffer)[display->updRow * DISPLAY_WIDTH + rect->x0], width * rows);
+
+	display->updRow += rows;
+#endif
+
+	return 1;
+}
+
+
+/*
+ *	@brief	Set the function called when an asynchronous update is finished
+ *		The callback runs in the DMA interrupt context
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Callback, NULL to disable
+ *
+ *	@retval none
+ */
+void Display_SetUpdCallback(struct SSD1351 *display, void (*callback)(struct SSD1351 *display))
+{
+	display->updCallback = callback;
+}
+
+
+/*
+ *	@brief	DMA interrupt handler of the display
+ *		Call it from the IRQ handler of the stream assigned to display->dmaStream
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+void Display_DmaIrqHandler(struct SSD1351 *display)
+{
+	if(!(Display_DmaFlags(display) & DISPLAY_DMA_FLAG_TC)) return;
+
+	Display_DmaClearFlags(display);
+
+	display->dmaStream->CR &= ~DMA_SxCR_EN;
+
+	if(Display_DmaNext(display)) return;
+
+	Display_End(display);
+
+	display->updBusy = 0;
+
+	if(display->bus) display->bus->owner = NULL;
+
+	if(display->updCallback) display->updCallback(display);
+
+	if(display->bus) Display_BusServiceIrq(display->bus);	/* Next queued display goes right after this one */
+}
+
+
+/*
+ *	@brief	DMA interrupt handler of a shared bus
+ *		Displays on one SPI unit share its TX stream, call this from the IRQ handler of that stream
+ *
+ *	@param	Ptr to the bus
+ *
+ *	@retval none
+ */
+void Display_BusIrqHandler(struct Display_Bus *bus)
+{
+	if(bus->owner) Display_DmaIrqHandler(bus->owner);
+}
+
+
+/*
+ *	@brief	Start an update in the background
+ *		The dirty list is copied, so drawing may go on while the transport sends the snapshot
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+static void Display_UpdStart( struct SSD1351 * display )
+{
+	uint8_t i;
+
+	for(i = 0; i < display->dirtyCount; i++)
+	{
+		display->updRects[i] = display->dirty[i];
+	}
+
+	Display_BusAcquire(display);
+
+	if(display->bus) display->bus->owner = display;
+
+	display->updCount = display->dirtyCount;
+	display->updIndex = 0;
+	display->updRow = display->updRects[0].y0;
+	display->dirtyCount = 0;
+
+	display->updBusy = 1;
+
+#if DISPLAY_INDEXED
+	display->updLineReady = 0;
+#endif
+
+	display->updZoneEnd = Display_UpdOpenWindow(display, &display->updRects[0], display->updRow);
+	Display_DmaNext(display);
+}
+
+#endif /* DISPLAY_USE_DMA */
+
+
+#if defined(DISPLAY_USE_BANDS)
+
+/*
+ *	@brief	Send the pixels of a band piece that a partial list drew
+ *		Rows drawn across the whole piece go out together, the other rows as runs of drawn pixels
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Part of a dirty rectangle inside the band just rendered
+ *
+ *	@retval none
+ */
+static void Display_UpdSendDrawn( struct SSD1351 * display, const struct Display_Rect * piece )
+{
+	struct Display_Rect run;
+	uint16_t i;
+	uint8_t x, y, full = piece->y0;
+
+	for(y = piece->y0; y <= piece->y1; y++)
+	{
+		i = (y - display->bandY) * DISPLAY_WIDTH;
+
+		for(x = piece->x0; x <= piece->x1 && DISPLAY_BAND_DRAWN(display, i + x); x++);
+
+		if(x > piece->x1) continue;	/* Whole row drawn, joins the rows around it */
+
+		if(full < y)
+		{
+			run = (struct Display_Rect){ piece->x0, full, piece->x1, y - 1 };
+			Display_UpdSendRect(display, &run, &display->band[(full - display->bandY) * DISPLAY_WIDTH]);
+		}
+
+		full = y + 1;
+
+		for(x = piece->x0; x <= piece->x1; x++)
+		{
+			if(!DISPLAY_BAND_DRAWN(display, i + x)) continue;
+
+			run.x0 = x;
+			run.y0 = y;
+			run.y1 = y;
+
+			while(x < piece->x1 && DISPLAY_BAND_DRAWN(display, i + x + 1)) x++;
+
+			run.x1 = x;
+			Display_UpdSendRect(display, &run, &display->band[i]);
+		}
+	}
+
+	if(full <= piece->y1)
+	{
+		run = (struct Display_Rect){ piece->x0, full, piece->x1, piece->y1 };
+		Display_UpdSendRect(display, &run, &display->band[(full - display->bandY) * DISPLAY_WIDTH]);
+	}
+}
+
+#endif /* DISPLAY_USE_BANDS */
+
+
+/*
+ *	@brief	Send the dirty rectangles through the transport, blocking
+ *		With bands every band that holds a part of them is rendered and sent in turn
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+static void Display_UpdSend( struct SSD1351 * display )
+{
+#if defined(DISPLAY_USE_BANDS)
+	struct Display_Rect piece;
+	const struct Display_Rect *rect;
+	uint8_t i, rendered;
+	uint16_t bandY;
+
+	for(bandY = 0; bandY < DISPLAY_HEIGHT; bandY += DISPLAY_BAND_HEIGHT)
+	{
+		rendered = 0;
+
+		for(i = 0; i < display->dirtyCount; i++)
+		{
+			rect = &display->dirty[i];
+
+			if(rect->y1 < bandY || rect->y0 >= bandY + DISPLAY_BAND_HEIGHT) continue;
+
+			if(!rendered)	/* Bands without changes are neither rendered nor sent */
+			{
+				Display_RenderBand(display, bandY);
+				rendered = 1;
+			}
+
+			piece.x0 = rect->x0;
+			piece.x1 = rect->x1;
+			piece.y0 = rect->y0 > bandY ? rect->y0 : bandY;
+			piece.y1 = rect->y1 < bandY + DISPLAY_BAND_HEIGHT - 1 ? rect->y1 : bandY + DISPLAY_BAND_HEIGHT - 1;
+
+			if(display->listPartial) Display_UpdSendDrawn(display, &piece);
+			else Display_UpdSendRect(display, &piece, &display->band[(piece.y0 - bandY) * DISPLAY_WIDTH]);
+		}
+	}
+#else
+	const struct Display_Rect *rect;
+	uint8_t i;
+
+	for(i = 0; i < display->dirtyCount; i++)
+	{
+		rect = &display->dirty[i];
+
+#if DISPLAY_INDEXED
+		Display_UpdSendIndexed(display, rect);
+#else
+		Display_UpdSendRect(display, rect, &((const uint16_t *)&display->frameBuffer)[rect->y0 * DISPLAY_WIDTH]);
+#endif
+	}
+#endif
+
+	display->dirtyCount = 0;
+
+	Display_End(display);
+}
+
+
+/*
+ *	@brief	Send the changed parts of the frame buffer to the display
+ *		Only the dirty rectangles collected by the drawing functions are sent, each through its own draw zone.
+ *		Call Display_Invalidate before to send the whole frame.
+ *		When the transport writes asynchronously (DMA) the transfer is handed to it and the function returns immediately,
+ *		use Display_IsBusy/Display_WaitUpd or the update callback to find out when it is finished.
+ *		A new update waits for the previous one to complete.
+ *
+ *	@note	Do not draw while an asynchronous update is in progress, the frame may tear
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+void Display_Upd(struct SSD1351 *display)
+{
+	Display_WaitUpd(display);
+
+	if(display->dirtyCount == 0) return;	/* Nothing changed since the last update */
+
+#if defined(DISPLAY_USE_STATS)
+	uint32_t start = DISPLAY_CYCLES();
+
+	display->stats.flushes++;
+#endif
+
+#if defined(DISPLAY_USE_DMA)
+	if(display->transport->writeAsync)	/* Sent in the background, Display_DmaIrqHandler starts each next part */
+	{
+		Display_UpdStart(display);
+	}
+	else
+#endif
+	{
+		Display_UpdSend(display);
+	}
+
+#if defined(DISPLAY_USE_STATS)
+	display->stats.updCycles += DISPLAY_CYCLES() - start;
+#endif
+}
+
+
+/*
+ *	@brief	Check whether a frame buffer update is in progress
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval	1 - update in progress, 0 - display is idle
+ */
+uint8_t Display_IsBusy(struct SSD1351 *display)
+{
+#if defined(DISPLAY_USE_DMA)
+	return display->updBusy;
+#else
+	(void)display;
+	return 0;
+#endif
+}
+
+
+/*
+ *	@brief	Wait until the frame buffer update is finished
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+void Display_WaitUpd(struct SSD1351 *display)
+{
+#if defined(DISPLAY_USE_DMA)
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();	/* WFI still wakes up on a pending interrupt, so the flag check can't miss it */
+
+	while(display->updBusy)
+	{
+		__WFI();
+		__enable_irq();
+		__disable_irq();
+	}
+
+	__set_PRIMASK(primask);	/* Interrupts stay off when the caller had them off */
+#else
+	(void)display;
+#endif
+}
+
+
+/*
+ *	@brief	Pick the next queued display of a bus: highest priority, equal priorities in turn
+ *
+ *	@param	Ptr to the bus
+ *	@param	1 - only displays whose transport writes asynchronously, the others stay queued
+ *
+ *	@retval	Display taken out of the queue, NULL - queue is empty
+ */
+static struct SSD1351 * Display_BusNext( struct Display_Bus * bus, uint8_t asyncOnly )
+{
+	struct SSD1351 *display, *next = NULL;
+	uint8_t i, k, nextIndex = 0;
+
+	for(i = 0; i < bus->count; i++)
+	{
+		k = (bus->turn + i) % bus->count;
+		display = bus->displays[k];
+
+		if(asyncOnly && display->transport->writeAsync == NULL) continue;
+
+		if(display->updQueued && (next == NULL || display->updPriority > next->updPriority))
+		{
+			next = display;
+			nextIndex = k;
+		}
+	}
+
+	if(next)
+	{
+		next->updQueued = 0;
+		bus->turn = nextIndex + 1;
+	}
+
+	return next;
+}
+
+
+/*
+ *	@brief	Send queued updates while the bus is free
+ *		Blocking updates are all sent here, a DMA update takes the bus and the next DMA
+ *		update is started by the interrupt that finishes it
+ *
+ *	@param	Ptr to the bus
+ *
+ *	@retval none
+ */
+static void Display_BusService( struct Display_Bus * bus )
+{
+	struct SSD1351 *display;
+
+	while(bus->owner == NULL && (display = Display_BusNext(bus, 0)) != NULL)
+	{
+		Display_Upd(display);
+	}
+}
+
+
+#if defined(DISPLAY_USE_DMA)
+
+/*
+ *	@brief	Start the next queued update from the DMA interrupt
+ *		Only transports that write asynchronously are started here. A blocking update would
+ *		run its whole flush inside the interrupt, it stays queued for Display_BusFlush
+ *
+ *	@param	Ptr to the bus
+ *
+ *	@retval none
+ */
+static void Display_BusServiceIrq( struct Display_Bus * bus )
+{
+	struct SSD1351 *display;
+
+	while(bus->owner == NULL && (display = Display_BusNext(bus, 1)) != NULL)
+	{
+		if(display->dirtyCount == 0) continue;	/* Nothing changed since the last update */
+
+		DISPLAY_STAT_ADD(display, flushes, 1);
+
+		Display_UpdStart(display);
+	}
+}
+
+#endif
+
+
+/*
+ *	@brief	Queue an update of the display on its bus
+ *		With DMA it starts at once when the bus is free, otherwise right after the transfer
+ *		in progress. Blocking updates are sent by Display_BusFlush.
+ *		A display without a bus is updated immediately
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+void Display_RequestUpd(struct SSD1351 *display)
+{
+	if(display->bus == NULL)
+	{
+		Display_Upd(display);
+		return;
+	}
+
+	display->updQueued = 1;
+
+#if defined(DISPLAY_USE_DMA)
+	Display_BusService(display->bus);
+#endif
+}
+
+
+/*
+ *	@brief	Send all queued updates of a bus back to back and wait for them
+ *
+ *	@param	Ptr to the bus
+ *
+ *	@retval none
+ */
+void Display_BusFlush(struct Display_Bus *bus)
+{
+#if defined(DISPLAY_USE_DMA)
+	uint32_t primask;
+
+	while(Display_BusIsBusy(bus))	/* Blocking updates queued behind a DMA one are left to this loop */
+	{
+		Display_BusService(bus);
+
+		primask = __get_PRIMASK();
+		__disable_irq();	/* Finished transfers start the next queued DMA update */
+
+		while(bus->owner)
+		{
+			__WFI();
+			__enable_irq();
+			__disable_irq();
+		}
+
+		__set_PRIMASK(primask);
+	}
+#else
+	Display_BusService(bus);
+#endif
+}
+
+
+/*
+ *	@brief	Check whether a bus is sending or has queued updates
+ *
+ *	@param	Ptr to the bus
+ *
+ *	@retval	1 - busy, 0 - idle
+ */
+uint8_t Display_BusIsBusy(struct Display_Bus *bus)
+{
+	uint8_t i;
+
+	if(bus->owner) return 1;
+
+	for(i = 0; i < bus->count; i++)
+	{
+		if(bus->displays[i]->updQueued) return 1;
+	}
+
+	return 0;
+}
+
+#endif /* DISPLAY_HAS_UPD */
+
+/*
+ *	@brief	Clear display
+ *		The display is filled with the color specified in the SSD1351->currentBackColor (black by default).
+ *		With bands this also starts a new display list
+ * 
+ *	@note	frequent use slows down the display greatly
+ * 
+ *	@param	Ptr to the SSD1351 struct
+ * 
+ *	@retval none
+ */
+void Display_Clear(struct SSD1351 *display)
+{
+	Display_Fill(display, display->currentBackColor);
+}
+
+
+/*
+ *	@brief Fill display with selected color
+ * 
+ *	@param Ptr to th SSD1351 struct
+ *	@param fill color
+ * 
+ *	@retval none
+ */
+void Display_Fill( struct SSD1351 * display, uint16_t color )
+{
+#if DISPLAY_INDEXED
+	memset(display->frameBuffer, DISPLAY_INDEX_BYTE(color), FRAME_BUFFER_SIZE);	/* 1/2 or 1/4 of the RGB565 stores */
+
+	Display_Invalidate(display);
+#elif DISPLAY_HAS_BUFFER
+	uint16_t i;
+
+	uint32_t color32 = color + ((uint32_t)color << 16);
+
+	for(i = 0; i < FRAME_BUFFER_SIZE /  4; i++)
+	{
+		((uint32_t *)&display->frameBuffer)[i] = color32;
+	}
+
+	Display_Invalidate(display);
+#elif defined(DISPLAY_USE_BANDS)
+	display->listCount = 0;		/* Nothing drawn before shows through, start a new list */
+	display->listTextUsed = 0;
+	display->listPartial = 0;
+
+	display->list[0].op = DISPLAY_OP_FILL;
+	display->list[0].y0 = 0;
+	display->list[0].y1 = DISPLAY_HEIGHT - 1;
+	display->list[0].drawColor = color;
+	display->listCount = 1;
+
+	if(display->originX || display->originY || display->clip.x0 || display->clip.y0 ||
+		display->clip.x1 != DISPLAY_WIDTH - 1 || display->clip.y1 != DISPLAY_HEIGHT - 1)
+	{
+		Display_ListView(display);	/* Replaying starts with the whole screen, record the current view again */
+	}
+
+	Display_Invalidate(display);
+#else
+	Display_FillRect(display, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, color);
+#endif
+}
+
+
+#if defined(DISPLAY_USE_BANDS)
+
+/*
+ *	@brief	Send the pending bands and start an empty list over the image on the display
+ *		The calls recorded after it are replayed without a background, only the pixels
+ *		they draw are sent (Display_RenderBand). Display_Clear or Display_Fill start a full list again
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+static void Display_ListFlush( struct SSD1351 * display )
+{
+	Display_Upd(display);
+
+	display->listCount = 0;
+	display->listTextUsed = 0;
+	display->listPartial = 1;
+
+	if(display->originX || display->originY || display->clip.x0 || display->clip.y0 ||
+		display->clip.x1 != DISPLAY_WIDTH - 1 || display->clip.y1 != DISPLAY_HEIGHT - 1)
+	{
+		Display_ListView(display);	/* Replaying starts with the whole screen, record the current view again */
+	}
+}
+
+
+/*
+ *	@brief	Record a draw call in the display list
+ *		Consecutive text runs on one line are joined. When the list or its text space is full
+ *		the pending bands are sent and the call starts a new list (Display_ListFlush). A call with more
+ *		data than the whole text space is recorded alone, without a copy, and sent right away
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	DISPLAY_OP_...
+ *	@param	4 argument bytes
+ *	@param	Bitmap, or data copied into listText: text (args[2] chars), corner radius, polygon corners (args[0] pairs)
+ *	@param	Visible part of the call, NULL - state change replayed in every band
+ *
+ *	@retval	1 - recorded, 0 - the caller has to draw now (replaying)
+ */
+static uint8_t Display_ListAdd( struct SSD1351 * display, uint8_t op, const uint8_t * args, const void * data, const struct Display_Rect * box )
+{
+	struct Display_ListEntry *entry;
+	uint16_t length;
+	uint8_t join, direct;
+
+	switch(op)
+	{
+	case DISPLAY_OP_TEXT:	length = args[2]; break;
+	case DISPLAY_OP_RFRAME:
+	case DISPLAY_OP_RBOX:
+	case DISPLAY_OP_THICK_LINE: length = 1; break;
+	case DISPLAY_OP_POLYGON:
+	case DISPLAY_OP_POLYLINE:
+	case DISPLAY_OP_FILLED_POLYGON: length = args[0] * 2; break;
+	default:		length = 0; break;
+	}
+
+	if(display->bandRows) return 0;
+
+	entry = &display->list[display->listCount ? display->listCount - 1 : 0];
+	join = display->listCount && op == DISPLAY_OP_TEXT && entry->op == DISPLAY_OP_TEXT && entry->args[1] == args[1] &&
+		entry->args[0] + entry->args[2] * DISPLAY_CURSOR_OFFSET_X == args[0] && entry->args[2] + length <= 0xFF &&
+		entry->drawColor == display->currentDrawColor && entry->backColor == display->currentBackColor &&
+		entry->drawMode == display->drawMode;	/* The text continues the previous run */
+
+	direct = length > DISPLAY_LIST_TEXT;	/* Can't be copied at all, drawn now from the caller's data */
+
+	if(direct || display->listTextUsed + length > DISPLAY_LIST_TEXT || (display->listCount >= DISPLAY_LIST_SIZE && !join))
+	{
+		Display_ListFlush(display);
+		join = 0;
+	}
+
+	if(length && !direct)
+	{
+		memcpy(&display->listText[display->listTextUsed], data, length);
+		data = &display->listText[display->listTextUsed];
+		display->listTextUsed += length;
+	}
+
+	if(box) Display_MarkDirty(display, box->x0, box->y0, box->x1, box->y1);
+
+	if(join)
+	{
+		entry->args[2] += length;
+		return 1;
+	}
+
+	entry = &display->list[display->listCount++];
+
+	entry->op = op;
+	entry->drawMode = display->drawMode;
+	entry->y0 = box ? box->y0 : 0;
+	entry->y1 = box ? box->y1 : DISPLAY_HEIGHT - 1;
+	memcpy(entry->args, args, sizeof(entry->args));
+	entry->drawColor = display->currentDrawColor;
+	entry->backColor = display->currentBackColor;
+	entry->data = data;
+
+	if(direct) Display_ListFlush(display);	/* Sent band by band before the caller's data may change */
+
+	return 1;
+}
+
+
+/*
+ *	@brief	Record the clip rectangle and origin, the calls recorded after it are replayed with them
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+static void Display_ListView( struct SSD1351 * display )
+{
+	struct Display_ListEntry *entry;
+
+	if(display->bandRows) return;
+
+	if(display->listCount && display->list[display->listCount - 1].op == DISPLAY_OP_VIEW)
+	{
+		display->listCount--;	/* Nothing was drawn through the previous view */
+	}
+
+	if(Display_ListAdd(display, DISPLAY_OP_VIEW, &display->clip.x0, NULL, NULL))
+	{
+		entry = &display->list[display->listCount - 1];
+		entry->drawColor = (uint16_t)display->originX;
+		entry->backColor = (uint16_t)display->originY;
+	}
+}
+
+
+/*
+ *	@brief	Replay the display list into the band buffer
+ *		Every call that reaches the band is made again with its recorded colors, mode and view
+ *		(the list starts with the whole screen), the pixel writers keep only the rows of the band
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+static void Display_ReplayList( struct SSD1351 * display )
+{
+	const struct Display_ListEntry *entry = display->list;
+	const uint8_t *a;
+	uint8_t y = display->bandY;
+	uint8_t bottom = display->bandY + display->bandRows - 1;
+	uint8_t i;
+
+	display->clip = (struct Display_Rect){ 0, 0, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1 };
+	display->originX = 0;
+	display->originY = 0;
+
+	for(i = 0; i < display->listCount; i++, entry++)
+	{
+		if(entry->y1 < y || entry->y0 > bottom) continue;
+
+		a = entry->args;
+
+		display->currentDrawColor = entry->drawColor;
+		display->currentBackColor = entry->backColor;
+		display->drawMode = entry->drawMode;
+
+		switch(entry->op)
+		{
+		case DISPLAY_OP_FILL:	Display_FillRect(display, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, entry->drawColor); break;
+		case DISPLAY_OP_PIXEL:	Display_DrawPixel(display, a[0], a[1], ((uint16_t)a[2] << 8) | a[3]); break;
+		case DISPLAY_OP_LINE:	Display_DrawLine(display, a[0], a[1], a[2], a[3]); break;
+		case DISPLAY_OP_FRAME:	Display_DrawFrame(display, a[0], a[1], a[2], a[3]); break;
+		case DISPLAY_OP_BOX:	Display_DrawBox(display, a[0], a[1], a[2], a[3]); break;
+		case DISPLAY_OP_TEXT:	Display_DrawTextRun(display, a[0], a[1], entry->data, a[2]); break;
+		case DISPLAY_OP_XBM:	Display_DrawXBM(display, a[0], a[1], a[2], a[3], (uint8_t *)entry->data); break;
+		case DISPLAY_OP_PACKED:	Display_DrawPackedIMG(display, a[0], a[1], entry->data); break;
+		case DISPLAY_OP_IMG:	Display_BlitIMG(display, a[0], a[1], a[2], a[3], entry->data, entry->drawColor, 0, 0); break;
+		case DISPLAY_OP_IMG_KEY: Display_BlitIMG(display, a[0], a[1], a[2], a[3], entry->data, entry->drawColor, 1, entry->backColor); break;
+		case DISPLAY_OP_ELLIPSE: Display_DrawEllipse(display, a[0], a[1], a[2], a[3]); break;
+		case DISPLAY_OP_FILLED_ELLIPSE: Display_DrawFilledEllipse(display, a[0], a[1], a[2], a[3]); break;
+		case DISPLAY_OP_RFRAME:	Display_DrawRFrame(display, a[0], a[1], a[2], a[3], *(const uint8_t *)entry->data); break;
+		case DISPLAY_OP_RBOX:	Display_DrawRBox(display, a[0], a[1], a[2], a[3], *(const uint8_t *)entry->data); break;
+		case DISPLAY_OP_POLYGON: Display_DrawPolygon(display, entry->data, a[0]); break;
+		case DISPLAY_OP_FILLED_POLYGON: Display_DrawFilledPolygon(display, entry->data, a[0]); break;
+		case DISPLAY_OP_POLYLINE: Display_DrawPolyline(display, entry->data, a[0]); break;
+		case DISPLAY_OP_THICK_LINE: Display_DrawThickLine(display, a[0], a[1], a[2], a[3], *(const uint8_t *)entry->data); break;
+		case DISPLAY_OP_VIEW:
+			display->clip = (struct Display_Rect){ a[0], a[1], a[2], a[3] };
+			display->originX = (int16_t)entry->drawColor;
+			display->originY = (int16_t)entry->backColor;
+			break;
+		default: break;
+		}
+	}
+}
+
+
+/*
+ *	@brief	Render the display list into the band buffer
+ *		A partial list (Display_ListFlush) has no background, it is replayed twice: over 0x0000
+ *		and over 0xFFFF. Pixels that keep both values weren't drawn, bandDrawn marks the others
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Top screen row of the band
+ *
+ *	@retval none
+ */
+static void Display_RenderBand( struct SSD1351 * display, uint8_t y )
+{
+	uint16_t drawColor = display->currentDrawColor;
+	uint16_t backColor = display->currentBackColor;
+	uint8_t drawMode = display->drawMode;
+	struct Display_Rect clip = display->clip;
+	int16_t originX = display->originX;
+	int16_t originY = display->originY;
+	uint16_t i, pixels;
+
+	display->bandY = y;
+	display->bandRows = DISPLAY_HEIGHT - y < DISPLAY_BAND_HEIGHT ? DISPLAY_HEIGHT - y : DISPLAY_BAND_HEIGHT;
+
+	pixels = DISPLAY_WIDTH * display->bandRows;
+
+	if(display->listPartial)
+	{
+		Display_FillRows(display->band, DISPLAY_WIDTH, display->bandRows, 0x0000);
+		Display_ReplayList(display);
+
+		memset(display->bandDrawn, 0, sizeof(display->bandDrawn));
+
+		for(i = 0; i < pixels; i++)
+		{
+			if(display->band[i] != 0x0000) display->bandDrawn[i >> 3] |= 1 << (i & 0x07);
+		}
+
+		Display_FillRows(display->band, DISPLAY_WIDTH, display->bandRows, 0xFFFF);
+	}
+
+	Display_ReplayList(display);
+
+	if(display->listPartial)
+	{
+		for(i = 0; i < pixels; i++)
+		{
+			if(display->band[i] != 0xFFFF) display->bandDrawn[i >> 3] |= 1 << (i & 0x07);
+		}
+	}
+
+	display->currentDrawColor = drawColor;
+	display->currentBackColor = backColor;
+	display->drawMode = drawMode;
+	display->clip = clip;
+	display->originX = originX;
+	display->originY = originY;
+
+	display->bandRows = 0;
+}
+
+#endif /* DISPLAY_USE_BANDS */
+
+
+/*
+ *	@brief	Set display draw color
+ * 
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	New draw color
+ * 
+ *	@retval none
+ */
+void Display_SetDrawColor(struct SSD1351 *display, uint16_t color)
+{
+	display->currentDrawColor = color;
+}
+
+
+/*
+ *	@brief	Set display background color
+ * 
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	New background color
+ * 
+ *	@retval none
+ */
+void Display_SetBackColor(struct SSD1351 *display, uint16_t color)
+{
+	display->currentBackColor = color;
+}
+
+
+#if DISPLAY_INDEXED
+
+/*
+ *	@brief	Set palette entries of the indexed frame buffer
+ *		The next Display_Upd sends the whole frame with the new colors, nothing has to be redrawn
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	First index
+ *	@param	Number of entries, clipped to the palette size
+ *	@param	RGB565 colors
+ *
+ *	@retval none
+ */
+void Display_SetPalette(struct SSD1351 *display, uint8_t first, uint16_t count, const uint16_t *colors)
+{
+	uint16_t size = sizeof(display->palette) / sizeof(display->palette[0]);
+
+	if(first >= size || count == 0) return;
+	if(count > size - first) count = size - first;
+
+	Display_WaitUpd(display);	/* A running update expands rows through the palette */
+
+	memcpy(&display->palette[first], colors, count * sizeof(colors[0]));
+
+	Display_Invalidate(display);
+}
+
+#endif /* DISPLAY_INDEXED */
+
+
+/*
+ *	@brief	Set display xbm mode.
+ *		If mode != 0, then the empty XBM sections will overlap the previously displayed pixel.
+ *		DISPLAY_DRAW_MODE_BLEND works like COMPOSE, but pixels are mixed with the frame
+ *		using the alpha of Display_SetAlpha (opaque without an RGB565 frame buffer)
+ * 
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	New XBM mode
+ * 
+ *	@retval	none
+ */
+void Display_SetDrawMode(struct SSD1351 *display, uint8_t mode)
+{
+	display->drawMode = mode;
+}
+
+
+/*
+ *	@brief	Set the opacity of DISPLAY_DRAW_MODE_BLEND
+ *		Also scales the coverage of Display_DrawLineAA, Display_DrawIMGAlpha and Display_DrawAlphaMask
+ *		while blending
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	0 - transparent .. 255 - opaque
+ *
+ *	@retval	none
+ */
+void Display_SetAlpha(struct SSD1351 *display, uint8_t alpha)
+{
+	display->alpha = alpha;
+}
+
+
+/*
+ *	@brief	Limit drawing to a rectangle of the screen
+ *		Every primitive clips its geometry to it once, the pixels outside keep their color.
+ *		The rectangle is given in screen coordinates, the origin does not move it
+ *
+ *	@note	Display_Fill and Display_Clear always cover the whole screen
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Left x
+ *	@param	Top y
+ *	@param	Width, 0 - nothing is drawn until the clip changes
+ *	@param	Height
+ *
+ *	@retval	none
+ */
+void Display_SetClip(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+	uint16_t x1 = x + width - 1;
+	uint16_t y1 = y + height - 1;
+
+	if(x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT || width == 0 || height == 0)
+	{
+		display->clip = (struct Display_Rect){ 1, 1, 0, 0 };	/* Empty */
+	}
+	else
+	{
+		display->clip = (struct Display_Rect){ x, y, x1 < DISPLAY_WIDTH ? x1 : DISPLAY_WIDTH - 1, y1 < DISPLAY_HEIGHT ? y1 : DISPLAY_HEIGHT - 1 };
+	}
+
+#if defined(DISPLAY_USE_BANDS)
+	Display_ListView(display);
+#endif
+}
+
+
+/*
+ *	@brief	Let drawing reach the whole screen again
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval	none
+ */
+void Display_ResetClip(struct SSD1351 *display)
+{
+	Display_SetClip(display, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+}
+
+
+/*
+ *	@brief	Move the drawing coordinates
+ *		Drawing coordinate (0, 0) lands on screen pixel (x, y), every primitive is shifted by it
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Screen x of drawing x = 0, may be negative or past the screen
+ *	@param	Screen y of drawing y = 0
+ *
+ *	@retval	none
+ */
+void Display_SetOrigin(struct SSD1351 *display, int16_t x, int16_t y)
+{
+	display->originX = x;
+	display->originY = y;
+
+#if defined(DISPLAY_USE_BANDS)
+	Display_ListView(display);
+#endif
+}
+
+
+/*
+ *	@brief	Draw into a window of the screen as if it were a small display
+ *		Clips to the window and moves the origin to its top left corner,
+ *		Display_SetViewport(display, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT) returns to the whole screen
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Window left x
+ *	@param	Window top y
+ *	@param	Window width
+ *	@param	Window height
+ *
+ *	@retval	none
+ */
+void Display_SetViewport(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+	display->originX = x;
+	display->originY = y;
+
+	Display_SetClip(display, x, y, width, height);
+}
+
+
+/*
+ *	@brief	Turn the inverse display mode on or off
+ *		The controller complements every pixel on the way to the panel, display RAM is not touched
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	1 - inverse (0xA7), 0 - normal (0xA6)
+ *
+ *	@retval none
+ */
+void Display_SetInverse(struct SSD1351 *display, uint8_t inverse)
+{
+	display->inverse = inverse ? 1 : 0;
+
+	Display_WriteCommand(display, display->inverse ? 0xA7 : 0xA6, NULL, 0);
+}
+
+
+/*
+ *	@brief	Toggle the inverse display mode
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+void Display_Invert(struct SSD1351 *display)
+{
+	Display_SetInverse(display, !display->inverse);
+}
+
+
+#if DISPLAY_HAS_BUFFER
+
+/*
+ *	@brief	Swap two frame buffer rows
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	First row
+ *	@param	Second row
+ *
+ *	@retval none
+ */
+static void Display_SwapRows( struct SSD1351 * display, uint8_t a, uint8_t b )
+{
+	uint32_t *rowA = (uint32_t *)&display->frameBuffer[a * DISPLAY_ROW_BYTES];
+	uint32_t *rowB = (uint32_t *)&display->frameBuffer[b * DISPLAY_ROW_BYTES];
+	uint32_t pair;
+	uint8_t i;
+
+	for(i = 0; i < DISPLAY_ROW_BYTES / 4; i++)
+	{
+		pair = rowA[i];
+		rowA[i] = rowB[i];
+		rowB[i] = pair;
+	}
+}
+
+
+/*
+ *	@brief	Move the frame buffer content up, the top rows come back at the bottom
+ *		Keeps the buffer equal to the screen after the start line moved: rotation by three
+ *		row reversals, no second buffer. Dirty rectangles move along, one that ends up
+ *		crossing the bottom edge is split in two
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Rows to move (1..DISPLAY_HEIGHT - 1)
+ *
+ *	@retval none
+ */
+static void Display_RotateBuffer( struct SSD1351 * display, uint8_t rows )
+{
+	struct Display_Rect dirty[DISPLAY_DIRTY_RECTS];
+	struct Display_Rect *rect = dirty;
+	uint8_t first, last, i, count;
+
+	for(i = 0; i < 3; i++)
+	{
+		first = i == 1 ? rows : 0;
+		last = i == 0 ? rows - 1 : DISPLAY_HEIGHT - 1;
+
+		while(first < last)
+		{
+			Display_SwapRows(display, first++, last--);
+		}
+	}
+
+	count = display->dirtyCount;
+	memcpy(dirty, display->dirty, sizeof(dirty));
+
+	display->dirtyCount = 0;	/* Add them again so the pieces get merged */
+
+	for(i = 0; i < count; i++, rect++)
+	{
+		if(rect->y0 >= rows)
+		{
+			Display_MarkDirty(display, rect->x0, rect->y0 - rows, rect->x1, rect->y1 - rows);
+		}
+		else if(rect->y1 < rows)
+		{
+			Display_MarkDirty(display, rect->x0, rect->y0 + DISPLAY_HEIGHT - rows, rect->x1, rect->y1 + DISPLAY_HEIGHT - rows);
+		}
+		else
+		{
+			Display_MarkDirty(display, rect->x0, 0, rect->x1, rect->y1 - rows);
+			Display_MarkDirty(display, rect->x0, rect->y0 + DISPLAY_HEIGHT - rows, rect->x1, DISPLAY_HEIGHT - 1);
+		}
+	}
+}
+
+#endif /* DISPLAY_HAS_BUFFER */
+
+
+/*
+ *	@brief	Send a new start line and offset
+ *		The panel shows display RAM from row (line + offset) on. The frame buffer is
+ *		rotated to match, so drawing coordinates keep meaning screen coordinates.
+ *		With bands the pending list is sent first, the image moves with the display RAM and
+ *		a new list records the calls that follow over it (Display_ListFlush)
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Start line (0..DISPLAY_HEIGHT - 1)
+ *	@param	Offset (0..DISPLAY_HEIGHT - 1)
+ *
+ *	@retval none
+ */
+static void Display_SetScroll( struct SSD1351 * display, uint8_t line, uint8_t offset )
+{
+	uint8_t scrollY = (line + offset) % DISPLAY_HEIGHT;
+
+	Display_StopScrollH(display);
+
+#if defined(DISPLAY_USE_BANDS)
+	if(scrollY != display->scrollY) Display_ListFlush(display);	/* Recorded rows are screen rows of the old start line */
+#endif
+
+	if(line != display->startLine) Display_WriteCommand(display, 0xA1, &line, 1);
+	if(offset != display->lineOffset) Display_WriteCommand(display, 0xA2, &offset, 1);
+
+#if DISPLAY_HAS_BUFFER
+	if(scrollY != display->scrollY)
+	{
+		Display_RotateBuffer(display, (scrollY - display->scrollY + DISPLAY_HEIGHT) % DISPLAY_HEIGHT);
+	}
+#endif
+
+	display->startLine = line;
+	display->lineOffset = offset;
+	display->scrollY = scrollY;
+}
+
+
+/*
+ *	@brief	Set the display start line (0xA1)
+ *		The screen content moves up by the difference to the previous line,
+ *		rows leaving the top come back at the bottom. Nothing is resent
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Display RAM row shown at the top (with offset 0)
+ *
+ *	@retval none
+ */
+void Display_SetStartLine(struct SSD1351 *display, uint8_t line)
+{
+	Display_SetScroll(display, line % DISPLAY_HEIGHT, display->lineOffset);
+}
+
+
+/*
+ *	@brief	Set the display offset (0xA2)
+ *		Acts like the start line, the two are added
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Vertical offset in rows
+ *
+ *	@retval none
+ */
+void Display_SetOffset(struct SSD1351 *display, uint8_t offset)
+{
+	Display_SetScroll(display, display->startLine, offset % DISPLAY_HEIGHT);
+}
+
+
+/*
+ *	@brief	Scroll the screen vertically
+ *		The controller moves the image by changing the start line, only the rows that
+ *		scroll in are drawn (with currentBackColor) and sent
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Rows to scroll: > 0 - content moves up, < 0 - content moves down
+ *
+ *	@retval none
+ */
+void Display_ScrollV(struct SSD1351 *display, int16_t rows)
+{
+	uint16_t count = rows < 0 ? -rows : rows;
+	uint8_t y;
+
+	if(count == 0) return;
+	if(count > DISPLAY_HEIGHT) count = DISPLAY_HEIGHT;
+
+	if(rows > 0)
+	{
+		Display_SetScroll(display, (display->startLine + count) % DISPLAY_HEIGHT, display->lineOffset);
+		y = DISPLAY_HEIGHT - count;
+	}
+	else
+	{
+		Display_SetScroll(display, (display->startLine + DISPLAY_HEIGHT - count) % DISPLAY_HEIGHT, display->lineOffset);
+		y = 0;
+	}
+
+	Display_FillRect(display, 0, y, DISPLAY_WIDTH, count, display->currentBackColor);
+	Display_MarkDirty(display, 0, y, DISPLAY_WIDTH - 1, y + count - 1);
+}
+
+
+/*
+ *	@brief	Start the horizontal scroll engine of the controller
+ *		The rows rotate continuously without any SPI traffic.
+ *		The band stops at the display RAM wrap when the start line was moved
+ *
+ *	@note	Display RAM must not be written while the engine runs, stop it before the next update
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Columns per step: > 0 - to the right, < 0 - to the left (-63..63)
+ *	@param	Topmost row of the band
+ *	@param	Band height
+ *	@param	Step interval: DISPLAY_HSCROLL_TEST, _NORMAL, _SLOW or _SLOWEST
+ *
+ *	@retval none
+ */
+void Display_StartScrollH(struct SSD1351 *display, int8_t shift, uint8_t y, uint8_t height, uint8_t speed)
+{
+	if(y >= DISPLAY_HEIGHT || height == 0) return;
+
+	if(shift > 63) shift = 63;
+	if(shift < -63) shift = -63;
+
+	if(height > DISPLAY_HEIGHT - y) height = DISPLAY_HEIGHT - y;
+
+	height = Display_ZoneRows(display, y, height);	/* The engine takes a range of RAM rows */
+
+	Display_StopScrollH(display);	/* Setup is only accepted while stopped */
+
+	Display_WriteCommand(display, 0x96, (const uint8_t []){ (uint8_t)shift, (y + display->scrollY) % DISPLAY_HEIGHT, height, 0x00, speed & 0x03 }, 5);
+	Display_WriteCommand(display, 0x9F, NULL, 0);
+
+	display->hScrollY = y;
+	display->hScrollHeight = height;
+}
+
+
+/*
+ *	@brief	Stop the horizontal scroll engine
+ *		The controller needs the scrolled rows rewritten afterwards, they are marked dirty
+ *		(without a frame buffer the application has to redraw them)
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+void Display_StopScrollH(struct SSD1351 *display)
+{
+	if(display->hScrollHeight == 0) return;
+
+	Display_WriteCommand(display, 0x9E, NULL, 0);
+
+	Display_MarkDirty(display, 0, display->hScrollY, DISPLAY_WIDTH - 1, display->hScrollY + display->hScrollHeight - 1);
+
+	display->hScrollHeight = 0;
+}
+
+
+#if defined(DISPLAY_USE_STATS)
+
+/*
+ *	@brief	Take a snapshot of the bus statistics
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Destination
+ *
+ *	@retval none
+ */
+void Display_GetStats(struct SSD1351 *display, struct Display_Stats *stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();	/* The DMA interrupt may be updating them */
+	*stats = display->stats;
+	__set_PRIMASK(primask);	/* Interrupts stay off when the caller had them off */
+}
+
+
+/*
+ *	@brief	Reset the bus statistics
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+void Display_ResetStats(struct SSD1351 *display)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	memset(&display->stats, 0, sizeof(display->stats));
+	__set_PRIMASK(primask);
+}
+
+#endif /* DISPLAY_USE_STATS */
+
+
+#if DISPLAY_HAS_BLEND
+
+#define DISPLAY_ALPHA32(alpha)	(uint8_t)(((alpha) + 4) >> 3)	/* 0..255 to the 0..32 weight of the blend kernels */
+
+#define DISPLAY_SPREAD_MASK	0x07E0F81FUL	/* RGB565 in a 32 bit word with green moved to the upper half */
+
+#define DISPLAY_LANES_R(pair)	(((pair) >> 11) & 0x001F001FUL)	/* A component of two pixels, one per 16 bit lane */
+#define DISPLAY_LANES_G(pair)	(((pair) >> 5) & 0x003F003FUL)
+#define DISPLAY_LANES_B(pair)	((pair) & 0x001F001FUL)
+
+/*
+ *	@brief	Mix two RGB565 colors
+ *		The components are spread apart far enough that one multiply scales all three of them
+ *
+ *	@param	Frame color
+ *	@param	Drawn color
+ *	@param	Weight of the drawn color, 0..32
+ *
+ *	@retval	(color * weight + back * (32 - weight)) / 32 per component
+ */
+static inline uint16_t Display_Blend( uint16_t back, uint16_t color, uint8_t weight )
+{
+	uint32_t b = (back | ((uint32_t)back << 16)) & DISPLAY_SPREAD_MASK;
+	uint32_t c = (color | ((uint32_t)color << 16)) & DISPLAY_SPREAD_MASK;
+
+	b = ((c * weight + b * (32 - weight)) >> 5) & DISPLAY_SPREAD_MASK;
+
+	return (uint16_t)(b | (b >> 16));
+}
+
+
+/*
+ *	@brief	Mix two frame pixels held in a 32 bit word, same result as Display_Blend
+ *		Each component of both pixels gets a 16 bit lane, wide enough for the products
+ *
+ *	@param	Two frame pixels
+ *	@param	Drawn red lanes, premultiplied by the weight
+ *	@param	Drawn green lanes, premultiplied by the weight
+ *	@param	Drawn blue lanes, premultiplied by the weight
+ *	@param	32 - weight
+ *
+ *	@retval	Two blended pixels
+ */
+static inline uint32_t Display_BlendPair( uint32_t back, uint32_t r, uint32_t g, uint32_t b, uint8_t inverse )
+{
+	r = ((DISPLAY_LANES_R(back) * inverse + r) >> 5) & 0x001F001FUL;
+	g = ((DISPLAY_LANES_G(back) * inverse + g) >> 5) & 0x003F003FUL;
+	b = ((DISPLAY_LANES_B(back) * inverse + b) >> 5) & 0x001F001FUL;
+
+	return (r << 11) | (g << 5) | b;
+}
+
+
+/*
+ *	@brief	Blend one color over rows of the frame buffer, two pixels per 32 bit word
+ *
+ *	@param	First pixel of the top row (rows are DISPLAY_WIDTH pixels apart)
+ *	@param	Pixels per row
+ *	@param	Rows
+ *	@param	Drawn color
+ *	@param	Weight of the drawn color, 0..32
+ *
+ *	@retval none
+ */
+static void Display_BlendRows( uint16_t * row, uint8_t width, uint8_t height, uint16_t color, uint8_t weight )
+{
+	uint32_t color32 = color + ((uint32_t)color << 16);
+	uint32_t r = DISPLAY_LANES_R(color32) * weight;
+	uint32_t g = DISPLAY_LANES_G(color32) * weight;
+	uint32_t b = DISPLAY_LANES_B(color32) * weight;
+	uint16_t *pixel;
+	uint32_t *pair;
+	uint8_t i, count;
+
+	while(height--)
+	{
+		pixel = row;
+		count = width;
+
+		if(((uintptr_t)pixel & 0x02) && count)	/* Align to a word */
+		{
+			*pixel = Display_Blend(*pixel, color, weight);
+			pixel++;
+			count--;
+		}
+
+		pair = (uint32_t *)pixel;
+
+		for(i = count >> 1; i; i--, pair++)
+		{
+			*pair = Display_BlendPair(*pair, r, g, b, 32 - weight);
+		}
+
+		if(count & 1) *(uint16_t *)pair = Display_Blend(*(uint16_t *)pair, color, weight);
+
+		row += DISPLAY_WIDTH;
+	}
+}
+
+
+/*
+ *	@brief	Blend a line of pixels over a frame buffer row, two pixels per 32 bit word
+ *
+ *	@param	Destination
+ *	@param	Drawn pixels
+ *	@param	Pixels
+ *	@param	Weight of the drawn pixels, 0..32
+ *
+ *	@retval none
+ */
+static void Display_BlendLine( uint16_t * dst, const uint16_t * src, uint8_t width, uint8_t weight )
+{
+	uint32_t pair;
+
+	if(((uintptr_t)dst & 0x02) && width)	/* Align to a word */
+	{
+		*dst = Display_Blend(*dst, *src++, weight);
+		dst++;
+		width--;
+	}
+
+	for(; width >= 2; width -= 2, dst += 2, src += 2)
+	{
+		memcpy(&pair, src, sizeof(pair));	/* Source may be unaligned */
+
+		*(uint32_t *)dst = Display_BlendPair(*(uint32_t *)dst, DISPLAY_LANES_R(pair) * weight,
+				DISPLAY_LANES_G(pair) * weight, DISPLAY_LANES_B(pair) * weight, 32 - weight);
+	}
+
+	if(width) *dst = Display_Blend(*dst, *src, weight);
+}
+
+#endif /* DISPLAY_HAS_BLEND */
+
+
+/*
+ *	@brief	Write pixel without bounds checking
+ *		Internal writer for primitives that already clipped their geometry.
+ *		In buffered mode this is a plain memory store, SPI is only touched by Display_Upd
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Pixel x coordinate (must be < DISPLAY_WIDTH)
+ *	@param	Pixel y coordinate (must be < DISPLAY_HEIGHT)
+ *	@param	Pixel color
+ *
+ *	@retval none
+ */
+static inline void Display_PutPixel( struct SSD1351 * display, uint8_t x, uint8_t y, uint16_t color )
+{
+#if DISPLAY_INDEXED && DISPLAY_BUFFER_BPP == 8
+	display->frameBuffer[DISPLAY_ROW_BYTES * y + x] = (uint8_t)color;
+#elif DISPLAY_INDEXED
+	uint8_t *pair = &display->frameBuffer[DISPLAY_ROW_BYTES * y + x / 2];	/* Even column in the high nibble */
+
+	*pair = x & 1 ? (*pair & 0xF0) | (color & 0x0F) : (*pair & 0x0F) | (uint8_t)((color & 0x0F) << 4);
+#elif DISPLAY_HAS_BUFFER
+	uint16_t *pixel = &((uint16_t*)&display->frameBuffer)[DISPLAY_WIDTH * y + x];
+
+	*pixel = display->drawMode == DISPLAY_DRAW_MODE_BLEND ? Display_Blend(*pixel, color, DISPLAY_ALPHA32(display->alpha)) : color;
+#else
+#if defined(DISPLAY_USE_BANDS)
+	if(display->bandRows)	/* Replaying the display list, only the rows of the band are kept */
+	{
+		y -= display->bandY;
+
+		if(y < display->bandRows) display->band[DISPLAY_WIDTH * y + x] = color;
+		return;
+	}
+#endif
+
+	Display_SetDrawZone(display, x, y, 1, 1);
+
+	Display_WriteColor(display, color, 1);
+#endif
+}
+
+
+#if DISPLAY_INDEXED
+
+/*
+ *	@brief	Read part of a frame buffer row as one index per pixel
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Leftmost x
+ *	@param	Row
+ *	@param	Pixels (x + width <= DISPLAY_WIDTH)
+ *	@param	Destination
+ *
+ *	@retval none
+ */
+static void Display_LoadRow( struct SSD1351 * display, uint8_t x, uint8_t y, uint8_t width, uint16_t * out )
+{
+#if DISPLAY_BUFFER_BPP == 8
+	const uint8_t *src = &display->frameBuffer[DISPLAY_ROW_BYTES * y + x];
+
+	while(width--)
+	{
+		*out++ = *src++;
+	}
+#else
+	const uint8_t *src = &display->frameBuffer[DISPLAY_ROW_BYTES * y + x / 2];
+
+	for(; width; width--, x++)
+	{
+		*out++ = x & 1 ? *src++ & 0x0F : *src >> 4;
+	}
+#endif
+}
+
+
+/*
+ *	@brief	Write one index per pixel into part of a frame buffer row
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Leftmost x
+ *	@param	Row
+ *	@param	Pixels (x + width <= DISPLAY_WIDTH)
+ *	@param	Indices
+ *
+ *	@retval none
+ */
+static void Display_StoreRow( struct SSD1351 * display, uint8_t x, uint8_t y, uint8_t width, const uint16_t * line )
+{
+#if DISPLAY_BUFFER_BPP == 8
+	uint8_t *dst = &display->frameBuffer[DISPLAY_ROW_BYTES * y + x];
+
+	while(width--)
+	{
+		*dst++ = (uint8_t)*line++;
+	}
+#else
+	for(; width; width--, x++)
+	{
+		Display_PutPixel(display, x, y, *line++);
+	}
+#endif
+}
+
+#endif /* DISPLAY_INDEXED */
+
+
+#if (DISPLAY_HAS_BUFFER && !DISPLAY_INDEXED) || defined(DISPLAY_USE_BANDS)
+
+/*
+ *	@brief	Fill rows of a pixel buffer with 32 bit stores
+ *
+ *	@param	First pixel of the top row (rows are DISPLAY_WIDTH pixels apart)
+ *	@param	Pixels per row
+ *	@param	Rows
+ *	@param	Fill color
+ *
+ *	@retval none
+ */
+static void Display_FillRows( uint16_t * row, uint8_t width, uint8_t height, uint16_t color )
+{
+	uint32_t color32 = color + ((uint32_t)color << 16);
+	uint16_t *pixel;
+	uint32_t *pair;
+	uint8_t i, count;
+
+	while(height--)
+	{
+		pixel = row;
+		count = width;
+
+		if(((uintptr_t)pixel & 0x02) && count)	/* Align to a word */
+		{
+			*pixel++ = color;
+			count--;
+		}
+
+		pair = (uint32_t *)pixel;
+
+		for(i = count >> 1; i; i--)
+		{
+			*pair++ = color32;
+		}
+
+		if(count & 1) *(uint16_t *)pair = color;
+
+		row += DISPLAY_WIDTH;
+	}
+}
+
+#endif
+
+
+/*
+ *	@brief	Fill a rectangle without bounds checking
+ *		Span kernel for primitives that already clipped their geometry. Buffered rows are
+ *		written (or blended) with 32 bit stores, unbuffered the rectangle is one draw zone and one color burst
+ *		(two of each when it crosses the RAM wrap)
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Leftmost x
+ *	@param	Topmost y
+ *	@param	Width (x + width <= DISPLAY_WIDTH)
+ *	@param	Height (y + height <= DISPLAY_HEIGHT)
+ *	@param	Fill color
+ *
+ *	@retval none
+ */
+static void Display_FillRect( struct SSD1351 * display, uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint16_t color )
+{
+#if DISPLAY_INDEXED
+	uint8_t *row = &display->frameBuffer[DISPLAY_ROW_BYTES * y + x * DISPLAY_BUFFER_BPP / 8];
+	uint8_t fill = DISPLAY_INDEX_BYTE(color);
+
+	for(; height; height--, row += DISPLAY_ROW_BYTES)
+	{
+#if DISPLAY_BUFFER_BPP == 8
+		memset(row, fill, width);
+#else
+		uint8_t *pair = row;
+		uint8_t count = width;
+
+		if(x & 1)	/* Leading low nibble */
+		{
+			*pair = (*pair & 0xF0) | (fill & 0x0F);
+			pair++;
+			count--;
+		}
+
+		memset(pair, fill, count / 2);
+
+		if(count & 1) pair[count / 2] = (pair[count / 2] & 0x0F) | (fill & 0xF0);	/* Trailing high nibble */
+#endif
+	}
+#elif DISPLAY_HAS_BUFFER
+	uint16_t *row = &((uint16_t *)&display->frameBuffer)[DISPLAY_WIDTH * y + x];
+
+	if(display->drawMode == DISPLAY_DRAW_MODE_BLEND)
+	{
+		Display_BlendRows(row, width, height, color, DISPLAY_ALPHA32(display->alpha));
+	}
+	else
+	{
+		Display_FillRows(row, width, height, color);
+	}
+#else
+	uint8_t rows;
+
+#if defined(DISPLAY_USE_BANDS)
+	if(display->bandRows)	/* Replaying the display list: the part inside the band */
+	{
+		uint16_t top = y > display->bandY ? y : display->bandY;
+		uint16_t bottom = y + height < display->bandY + display->bandRows ? y + height : display->bandY + display->bandRows;
+
+		if(top < bottom) Display_FillRows(&display->band[DISPLAY_WIDTH * (top - display->bandY) + x], width, bottom - top, color);
+		return;
+	}
+#endif
+
+	while(height)	/* One zone, or two when the rectangle crosses the RAM wrap */
+	{
+		rows = Display_ZoneRows(display, y, height);
+
+		Display_SetDrawZone(display, x, y, width, rows);
+		Display_WriteColor(display, color, (uint32_t)width * rows);
+
+		y += rows;
+		height -= rows;
+	}
+#endif
+}
+
+
+/*
+ *	@brief	Move a rectangle by the origin and cut it to the clip rectangle
+ *		Primitives clip their geometry with it once, the kernels they call draw without checks
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Left x in drawing coordinates
+ *	@param	Top y in drawing coordinates
+ *	@param	Width
+ *	@param	Height
+ *	@param	Visible part in screen coordinates
+ *
+ *	@retval	1 - some of the rectangle is visible, 0 - none
+ */
+static uint8_t Display_ClipBox( struct SSD1351 * display, int16_t x, int16_t y, uint16_t width, uint16_t height, struct Display_Rect * box )
+{
+	int32_t x0 = (int32_t)x + display->originX;
+	int32_t y0 = (int32_t)y + display->originY;
+	int32_t x1 = x0 + width - 1;
+	int32_t y1 = y0 + height - 1;
+
+	if(width == 0 || height == 0) return 0;
+
+	if(x0 < display->clip.x0) x0 = display->clip.x0;
+	if(y0 < display->clip.y0) y0 = display->clip.y0;
+	if(x1 > display->clip.x1) x1 = display->clip.x1;
+	if(y1 > display->clip.y1) y1 = display->clip.y1;
+
+	if(x0 > x1 || y0 > y1) return 0;
+
+	*box = (struct Display_Rect){ x0, y0, x1, y1 };
+
+	return 1;
+}
+
+
+/*
+ *	@brief	Fill the visible part of a rectangle, the dirty area is left to the caller
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Left x in drawing coordinates
+ *	@param	Top y in drawing coordinates
+ *	@param	Width
+ *	@param	Height
+ *	@param	Fill color
+ *
+ *	@retval none
+ */
+static void Display_FillClipped( struct SSD1351 * display, int16_t x, int16_t y, uint16_t width, uint16_t height, uint16_t color )
+{
+	struct Display_Rect box;
+
+	if(Display_ClipBox(display, x, y, width, height, &box))
+	{
+		Display_FillRect(display, box.x0, box.y0, box.x1 - box.x0 + 1, box.y1 - box.y0 + 1, color);
+	}
+}
+
+
+/*
+ *	@brief	Cohen-Sutherland outcode of a point
+ *
+ *	@param	Clip rectangle
+ *	@param	Screen x
+ *	@param	Screen y
+ *
+ *	@retval	Bit 0 - left of the clip, 1 - right, 2 - above, 3 - below
+ */
+static uint8_t Display_OutCode( const struct Display_Rect * clip, int16_t x, int16_t y )
+{
+	return (x < clip->x0) | (x > clip->x1) << 1 | (y < clip->y0) << 2 | (y > clip->y1) << 3;
+}
+
+
+/*
+ *	@brief	First step of a line whose minor axis offset reaches a value
+ *		Step i of a line is offset round(i * minor / major) pixels, halves rounded down
+ *
+ *	@param	Minor axis offset
+ *	@param	Major axis length
+ *	@param	Minor axis length (> 0)
+ *
+ *	@retval	Step
+ */
+static int32_t Display_LineStep( int32_t offset, int16_t major, int16_t minor )
+{
+	if(offset <= 0) return 0;
+
+	return (2 * major * offset - major + 2 * minor) / (2 * minor);	/* ceil((2 * major * offset - major + 1) / (2 * minor)) */
+}
+
+
+/*
+ *	@brief	Draw pixel
+ * 
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Pixel x coordinate
+ *	@param	Pixel y coordinate
+ *	@param	Pixel color
+ * 
+ *	@retval none
+ */
+void Display_DrawPixel(struct SSD1351 *display, uint8_t x, uint8_t y, uint16_t color)
+{
+	struct Display_Rect box;
+
+	if(!Display_ClipBox(display, x, y, 1, 1, &box)) return;
+
+	DISPLAY_RECORD(display, DISPLAY_OP_PIXEL, x, y, color >> 8, color & 0xFF, NULL, box.x0, box.y0, box.x0, box.y0);
+
+	Display_PutPixel(display, box.x0, box.y0, color);
+	Display_MarkDirty(display, box.x0, box.y0, box.x0, box.y0);
+}
+
+
+#define DISPLAY_LINE_SKIP_FIRST	0x01	/* Display_Line: leave out the first pixel */
+#define DISPLAY_LINE_SKIP_LAST	0x02	/* Leave out the last one */
+
+/*
+ *	@brief	Draw a line (Bresenham)
+ *		The line is clipped once: outcodes reject lines beyond one clip edge, lines that
+ *		cross the clip get the range of steps inside it computed directly, so the visible
+ *		pixels are exactly those of the whole line and no step is checked.
+ *		Axis aligned lines are spans. With the RGB565 frame buffer the steps move a pixel
+ *		pointer, 45 degree lines take one diagonal step each; without a frame buffer
+ *		every run of pixels on one row or column is sent as one zone
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Start x
+ *	@param	Start y
+ *	@param	End x
+ *	@param	End y
+ *	@param	DISPLAY_LINE_SKIP_x flags, used where lines share their end pixels
+ *
+ *	@retval none
+ */
+static void Display_Line( struct SSD1351 * display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t skip )
+{
+	const struct Display_Rect *clip = &display->clip;
+	int16_t ax = x0 + display->originX, ay = y0 + display->originY;	/* Screen coordinates */
+	int16_t bx = x1 + display->originX, by = y1 + display->originY;
+	int16_t deltaX = abs(bx - ax);
+	int16_t deltaY = abs(by - ay);
+	uint8_t steep = deltaY > deltaX;
+	int16_t major = steep ? deltaY : deltaX;
+	int16_t minor = steep ? deltaX : deltaY;
+	int16_t stepX = ax < bx ? 1 : -1;
+	int16_t stepY = ay < by ? 1 : -1;
+	int32_t first = skip & DISPLAY_LINE_SKIP_FIRST ? 1 : 0, last = skip & DISPLAY_LINE_SKIP_LAST ? major - 1 : major;
+	int32_t low, high, error;
+	int16_t x, y, endX, endY;
+	uint16_t color = display->currentDrawColor;
+	struct Display_Rect box;
+
+	if(first > last) return;
+
+	if(Display_OutCode(clip, ax, ay) & Display_OutCode(clip, bx, by)) return;	/* Both ends beyond one clip edge */
+
+	if(deltaX == 0 || deltaY == 0)	/* Axis aligned lines are spans */
+	{
+		x = ax + (deltaX ? first * stepX : 0);
+		y = ay + (deltaY ? first * stepY : 0);
+		endX = ax + (deltaX ? last * stepX : 0);
+		endY = ay + (deltaY ? last * stepY : 0);
+
+		if(!Display_ClipBox(display, (x < endX ? x : endX) - display->originX, (y < endY ? y : endY) - display->originY,
+				abs(endX - x) + 1, abs(endY - y) + 1, &box)) return;
+
+		DISPLAY_RECORD(display, DISPLAY_OP_LINE, x0, y0, x1, y1, NULL, box.x0, box.y0, box.x1, box.y1);
+
+		Display_FillRect(display, box.x0, box.y0, box.x1 - box.x0 + 1, box.y1 - box.y0 + 1, color);
+		Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+		return;
+	}
+
+	if(Display_OutCode(clip, ax, ay) | Display_OutCode(clip, bx, by))	/* Steps inside the clip */
+	{
+		int16_t start = steep ? ay : ax, sign = steep ? stepY : stepX;
+
+		low = sign > 0 ? (steep ? clip->y0 : clip->x0) - start : start - (steep ? clip->y1 : clip->x1);
+		high = sign > 0 ? (steep ? clip->y1 : clip->x1) - start : start - (steep ? clip->y0 : clip->x0);
+
+		if(low > first) first = low;
+		if(high < last) last = high;
+
+		start = steep ? ax : ay;
+		sign = steep ? stepX : stepY;
+
+		low = sign > 0 ? (steep ? clip->x0 : clip->y0) - start : start - (steep ? clip->x1 : clip->y1);	/* Minor axis offsets inside */
+		high = sign > 0 ? (steep ? clip->x1 : clip->y1) - start : start - (steep ? clip->x0 : clip->y0);
+
+		low = Display_LineStep(low, major, minor);
+		high = high < 0 ? -1 : Display_LineStep(high + 1, major, minor) - 1;
+
+		if(low > first) first = low;
+		if(high < last) last = high;
+
+		if(first > last) return;
+	}
+
+	error = 2 * first * minor + major - 1;	/* Offset of step i is (2 * i * minor + major - 1) / (2 * major) */
+	low = error / (2 * major);		/* Minor axis offsets of the first and last visible steps */
+	high = (2 * last * minor + major - 1) / (2 * major);
+	error %= 2 * major;
+
+	x = ax + (steep ? low : first) * stepX;	/* First visible pixel */
+	y = ay + (steep ? first : low) * stepY;
+	endX = ax + (steep ? high : last) * stepX;	/* Last one */
+	endY = ay + (steep ? last : high) * stepY;
+
+	box = (struct Display_Rect){ x < endX ? x : endX, y < endY ? y : endY, x < endX ? endX : x, y < endY ? endY : y };
+
+	DISPLAY_RECORD(display, DISPLAY_OP_LINE, x0, y0, x1, y1, NULL, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	last -= first;	/* Steps after the first visible pixel */
+
+#if DISPLAY_HAS_BLEND
+	{
+		uint16_t *pixel = &((uint16_t *)&display->frameBuffer)[DISPLAY_WIDTH * y + x];
+		int16_t majorStep = steep ? stepY * DISPLAY_WIDTH : stepX;
+		int16_t minorStep = steep ? stepX : stepY * DISPLAY_WIDTH;
+
+		if(display->drawMode == DISPLAY_DRAW_MODE_BLEND)
+		{
+			uint8_t weight = DISPLAY_ALPHA32(display->alpha);
+
+			for(; ; last--)
+			{
+				*pixel = Display_Blend(*pixel, color, weight);
+
+				if(last == 0) break;
+
+				pixel += majorStep;
+				error += 2 * minor;
+
+				if(error >= 2 * major)
+				{
+					error -= 2 * major;
+					pixel += minorStep;
+				}
+			}
+		}
+		else if(minor == major)	/* 45 degrees */
+		{
+			for(majorStep += minorStep; ; last--, pixel += majorStep)
+			{
+				*pixel = color;
+
+				if(last == 0) break;
+			}
+		}
+		else
+		{
+			for(; ; last--)
+			{
+				*pixel = color;
+
+				if(last == 0) break;
+
+				pixel += majorStep;
+				error += 2 * minor;
+
+				if(error >= 2 * major)
+				{
+					error -= 2 * major;
+					pixel += minorStep;
+				}
+			}
+		}
+	}
+#elif DISPLAY_HAS_BUFFER
+	for(; ; last--)
+	{
+		Display_PutPixel(display, x, y, color);
+
+		if(last == 0) break;
+
+		error += 2 * minor;
+
+		if(steep)
+		{
+			y += stepY;
+
+			if(error >= 2 * major)
+			{
+				error -= 2 * major;
+				x += stepX;
+			}
+		}
+		else
+		{
+			x += stepX;
+
+			if(error >= 2 * major)
+			{
+				error -= 2 * major;
+				y += stepY;
+			}
+		}
+	}
+#else
+	for(endX = x, endY = y; ; last--)	/* endX, endY: start of the run */
+	{
+		if(last == 0 || error + 2 * minor >= 2 * major)	/* The run ends at this pixel */
+		{
+			Display_FillRect(display, x < endX ? x : endX, y < endY ? y : endY, abs(x - endX) + 1, abs(y - endY) + 1, color);
+
+			if(last == 0) break;
+
+			error -= 2 * major;
+			x += stepX;
+			y += stepY;
+			endX = x;
+			endY = y;
+		}
+		else if(steep)
+		{
+			y += stepY;
+		}
+		else
+		{
+			x += stepX;
+		}
+
+		error += 2 * minor;
+	}
+#endif
+}
+
+
+/*
+ *	@brief	Draw a line
+ *
+ *	@note	The line color is set by the currentDrawColor value
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Start x
+ *	@param	Start y
+ *	@param	End x
+ *	@param	End y
+ *
+ *	@retval none
+ */
+void Display_DrawLine(struct SSD1351 *display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+	Display_Line(display, x0, y0, x1, y1, 0);
+}
+
+
+/*
+ *	@brief	Draw lines joining a list of points, each joint pixel is drawn once
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Points: x0, y0, x1, y1...
+ *	@param	Number of points
+ *	@param	1 - join the last point to the first one
+ *
+ *	@retval none
+ */
+static void Display_Lines( struct SSD1351 * display, const uint8_t * points, uint8_t count, uint8_t closed )
+{
+	uint8_t k;
+
+	for(k = 0; k + 1 < count; k++)
+	{
+		Display_Line(display, points[2 * k], points[2 * k + 1], points[2 * k + 2], points[2 * k + 3], k ? DISPLAY_LINE_SKIP_FIRST : 0);
+	}
+
+	if(count == 1)
+	{
+		Display_Line(display, points[0], points[1], points[0], points[1], 0);
+	}
+	else if(closed)
+	{
+		Display_Line(display, points[2 * k], points[2 * k + 1], points[0], points[1], DISPLAY_LINE_SKIP_FIRST | DISPLAY_LINE_SKIP_LAST);
+	}
+}
+
+
+#if DISPLAY_HAS_BLEND
+
+/*
+ *	@brief	Blend the draw color into a frame buffer pixel, pixels outside the clip are skipped
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Pixel screen x coordinate
+ *	@param	Pixel screen y coordinate
+ *	@param	Coverage, 0..255
+ *
+ *	@retval none
+ */
+static void Display_BlendPixel( struct SSD1351 * display, int16_t x, int16_t y, uint8_t alpha )
+{
+	uint16_t *pixel;
+
+	if(Display_OutCode(&display->clip, x, y)) return;
+
+	pixel = &((uint16_t *)&display->frameBuffer)[DISPLAY_WIDTH * y + x];
+	*pixel = Display_Blend(*pixel, display->currentDrawColor, DISPLAY_ALPHA32(alpha));
+}
+
+#endif
+
+
+/*
+ *	@brief	Draw an anti-aliased line (Xiaolin Wu)
+ *		Each step along the major axis covers the two pixels closest to the line, weighted
+ *		by their distance to it. Axis aligned lines are exact and go to Display_DrawLine,
+ *		so does every line without an RGB565 frame buffer
+ *
+ *	@note	The line color is set by the currentDrawColor value. In BLEND mode the coverage is scaled by the alpha
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Start x
+ *	@param	Start y
+ *	@param	End x
+ *	@param	End y
+ *
+ *	@retval none
+ */
+void Display_DrawLineAA(struct SSD1351 *display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+#if DISPLAY_HAS_BLEND
+	int16_t ax = x0 + display->originX, ay = y0 + display->originY;	/* Screen coordinates */
+	int16_t bx = x1 + display->originX, by = y1 + display->originY;
+	uint8_t steep = abs(by - ay) > abs(bx - ax);
+	uint16_t alpha = display->drawMode == DISPLAY_DRAW_MODE_BLEND ? display->alpha : 255;
+	int16_t major, end, minor, low, high;
+	int32_t position, gradient;
+	uint8_t fraction;
+	struct Display_Rect box;
+
+	if(x0 == x1 || y0 == y1)
+	{
+		Display_DrawLine(display, x0, y0, x1, y1);
+		return;
+	}
+
+	if(!Display_ClipBox(display, x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1, abs(x1 - x0) + 1, abs(y1 - y0) + 1, &box)) return;
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	if(steep)	/* Step along y */
+	{
+		major = ay < by ? ay : by;
+		end = ay < by ? by : ay;
+		minor = ay < by ? ax : bx;
+		gradient = ((int32_t)(ay < by ? bx : ax) - minor) * 65536 / (end - major);
+		low = box.y0;
+		high = box.y1;
+	}
+	else
+	{
+		major = ax < bx ? ax : bx;
+		end = ax < bx ? bx : ax;
+		minor = ax < bx ? ay : by;
+		gradient = ((int32_t)(ax < bx ? by : ay) - minor) * 65536 / (end - major);
+		low = box.x0;
+		high = box.x1;
+	}
+
+	position = (int32_t)minor * 65536;	/* Minor axis in 16.16 fixed point, minor may be negative */
+
+	if(major < low)	/* Start at the clip, the minor axis edges are checked per pixel */
+	{
+		position += gradient * (low - major);
+		major = low;
+	}
+
+	if(end > high) end = high;
+
+	for(; major <= end; major++, position += gradient)
+	{
+		minor = position >> 16;
+		fraction = (position >> 8) & 0xFF;
+
+		if(steep)
+		{
+			Display_BlendPixel(display, minor, major, alpha * (255 - fraction) / 255);
+			if(fraction) Display_BlendPixel(display, minor + 1, major, alpha * fraction / 255);
+		}
+		else
+		{
+			Display_BlendPixel(display, major, minor, alpha * (255 - fraction) / 255);
+			if(fraction) Display_BlendPixel(display, major, minor + 1, alpha * fraction / 255);
+		}
+	}
+#else
+	Display_DrawLine(display, x0, y0, x1, y1);
+#endif
+}
+
+
+/*
+ *	@brief	Find the glyph of a character in font_5x8
+ *
+ *	@param	ASCII (or CP1251 cyrillic) char
+ *
+ *	@retval	DISPLAY_FONT_WIDTH column bytes, bit 0 is the top row
+ */
+static const uint8_t * Display_Glyph( uint8_t asciiChr )
+{
+	if((asciiChr >= 0x20) && (asciiChr <= 0x7f)) /*ASCII table offset selection*/
+	{
+		asciiChr -= 32;
+	}
+	else if(asciiChr >= 0xc0)
+	{
+		asciiChr -= 96;
+	}
+	else
+	{
+		asciiChr = 85;
+	}
+
+	return &font_5x8[asciiChr * DISPLAY_FONT_WIDTH];
+}
+
+
+/*
+ *	@brief	Pick one row out of the glyph columns
+ *
+ *	@param	Glyph
+ *	@param	Row inside the cell, rows outside the glyph are empty
+ *
+ *	@retval	Bit i - column i is set
+ */
+static uint8_t Display_GlyphBits( const uint8_t * glyph, uint8_t row )
+{
+	uint8_t bits = 0;
+	uint8_t i;
+
+	if(row < DISPLAY_FONT_HEIGHT)
+	{
+		for(i = 0; i < DISPLAY_FONT_WIDTH; i++)
+		{
+			bits |= ((glyph[i] >> row) & 1) << i;
+		}
+	}
+
+	return bits;
+}
+
+
+#if DISPLAY_HAS_BLEND
+
+/*
+ *	@brief	Find the empty pixels of a glyph row that smooth its diagonal steps
+ *		Two set pixels touching only at a corner get both empty pixels between them
+ *
+ *	@param	Glyph
+ *	@param	Row inside the cell
+ *
+ *	@retval	Bit i - column i is a step pixel
+ */
+static uint8_t Display_GlyphSteps( const uint8_t * glyph, uint8_t row )
+{
+	uint8_t bits = Display_GlyphBits(glyph, row);
+	uint8_t up = Display_GlyphBits(glyph, row - 1);		/* Row 0 - 1 wraps past the glyph and is empty */
+	uint8_t down = Display_GlyphBits(glyph, row + 1);
+	uint8_t left = bits << 1;	/* Bit i - column i - 1 is set */
+	uint8_t right = bits >> 1;
+
+	return ~bits & ((up & ((left & ~(up << 1)) | (right & ~(up >> 1)))) |
+			(down & ((left & ~(down << 1)) | (right & ~(down >> 1)))));
+}
+
+#endif
+
+
+/*
+ *	@brief	Expand one pixel row of a run of character cells
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Glyphs of the run
+ *	@param	Columns of the first cell that are cut off
+ *	@param	Row inside the cell (0..DISPLAY_CURSOR_OFFSET_Y - 1)
+ *	@param	Pixels to produce
+ *	@param	Destination, pixels that are not set stay untouched in COMPOSE mode.
+ *		In BLEND mode set pixels are blended, diagonal steps at half the alpha
+ *
+ *	@retval none
+ */
+static void Display_GlyphRow( struct SSD1351 * display, const uint8_t * const * glyphs, uint8_t skip, uint8_t row, uint8_t width, uint16_t * out )
+{
+	const uint16_t colors[2] = { display->currentBackColor, display->currentDrawColor };
+	uint8_t override = display->drawMode == DISPLAY_DRAW_MODE_OVERRIDE;
+	const uint8_t *glyph;
+	uint8_t bits, count, i;
+
+	while(width)
+	{
+		glyph = *glyphs++;
+		bits = Display_GlyphBits(glyph, row) >> skip;	/* The spacing row stays empty */
+
+		count = DISPLAY_CURSOR_OFFSET_X - skip;
+		if(count > width) count = width;
+
+		if(override)
+		{
+			for(i = 0; i < count; i++)
+			{
+				out[i] = colors[(bits >> i) & 1];
+			}
+		}
+#if DISPLAY_HAS_BLEND
+		else if(display->drawMode == DISPLAY_DRAW_MODE_BLEND)
+		{
+			uint8_t steps = Display_GlyphSteps(glyph, row) >> skip;
+			uint8_t weight = DISPLAY_ALPHA32(display->alpha);
+
+			for(i = 0; i < count; i++)
+			{
+				if((bits >> i) & 1)
+				{
+					out[i] = Display_Blend(out[i], colors[1], weight);
+				}
+				else if((steps >> i) & 1)
+				{
+					out[i] = Display_Blend(out[i], colors[1], weight / 2);
+				}
+			}
+		}
+#endif
+		else
+		{
+			for(i = 0; i < count; i++)
+			{
+				if((bits >> i) & 1) out[i] = colors[1];
+			}
+		}
+
+		out += count;
+		width -= count;
+		skip = 0;
+	}
+}
+
+
+/*
+ *	@brief	Draw a run of characters as one block of cells
+ *		Glyph columns are expanded row by row: straight into the frame buffer, or into a line
+ *		that is streamed through a single draw zone. In OVERRIDE mode the cells are filled
+ *		completely, spacing included, in COMPOSE mode only the set pixels are written
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Run x coordinate
+ *	@param	Run y coordinate
+ *	@param	Characters
+ *	@param	Number of characters
+ *
+ *	@retval none
+ */
+static void Display_DrawTextRun( struct SSD1351 * display, uint8_t x, uint8_t y, const uint8_t * str, uint8_t count )
+{
+	const uint8_t *glyphs[DISPLAY_WIDTH / DISPLAY_CURSOR_OFFSET_X + 2];	/* Cells that show, partly at both ends */
+	struct Display_Rect box;
+	uint16_t first;
+	uint8_t width, height, skip, top;
+	uint8_t i, j;
+
+	if(count == 0 || !Display_ClipBox(display, x, y, (uint16_t)count * DISPLAY_CURSOR_OFFSET_X, DISPLAY_CURSOR_OFFSET_Y, &box)) return;	/* Clip the run once */
+
+	first = box.x0 - (x + display->originX);	/* Columns cut off on the left */
+	top = box.y0 - (y + display->originY);		/* Rows cut off at the top */
+	width = box.x1 - box.x0 + 1;
+	height = box.y1 - box.y0 + 1;
+
+	skip = first % DISPLAY_CURSOR_OFFSET_X;
+	first /= DISPLAY_CURSOR_OFFSET_X;
+	count = (skip + width + DISPLAY_CURSOR_OFFSET_X - 1) / DISPLAY_CURSOR_OFFSET_X;
+
+	DISPLAY_RECORD(display, DISPLAY_OP_TEXT, x, y, first + count, 0, str, box.x0, box.y0, box.x1, box.y1);
+
+	for(i = 0; i < count; i++)
+	{
+		glyphs[i] = Display_Glyph(str[first + i]);
+	}
+
+	x = box.x0;
+	y = box.y0;
+
+#if DISPLAY_INDEXED
+	uint16_t line[DISPLAY_WIDTH];
+
+	Display_MarkDirty(display, x, y, x + width - 1, y + height - 1);
+
+	for(j = 0; j < height; j++)	/* Rows go through a line of indices, COMPOSE keeps the pixels read back */
+	{
+		if(display->drawMode != DISPLAY_DRAW_MODE_OVERRIDE) Display_LoadRow(display, x, y + j, width, line);
+
+		Display_GlyphRow(display, glyphs, skip, top + j, width, line);
+		Display_StoreRow(display, x, y + j, width, line);
+	}
+#elif DISPLAY_HAS_BUFFER
+	uint16_t *row = &((uint16_t *)&display->frameBuffer)[DISPLAY_WIDTH * y + x];
+
+	Display_MarkDirty(display, x, y, x + width - 1, y + height - 1);
+
+	for(j = 0; j < height; j++, row += DISPLAY_WIDTH)
+	{
+		Display_GlyphRow(display, glyphs, skip, top + j, width, row);
+	}
+#else
+	uint16_t line[DISPLAY_WIDTH];
+	uint8_t rows, k;
+
+#if defined(DISPLAY_USE_BANDS)
+	if(display->bandRows)	/* Replaying the display list: the rows inside the band */
+	{
+		uint16_t *row = display->band + x;
+
+		for(j = 0; j < height; j++)
+		{
+			k = y + j - display->bandY;
+
+			if(k < display->bandRows) Display_GlyphRow(display, glyphs, skip, top + j, width, row + DISPLAY_WIDTH * k);
+		}
+
+		return;
+	}
+#endif
+
+	if(display->drawMode != DISPLAY_DRAW_MODE_OVERRIDE)	/* Display RAM can't be read back, only the set pixels are sent */
+	{
+		for(j = 0; j < height && top + j < DISPLAY_FONT_HEIGHT; j++)
+		{
+			for(i = 0; i < width; i++)
+			{
+				k = (skip + i) % DISPLAY_CURSOR_OFFSET_X;
+
+				if(k < DISPLAY_FONT_WIDTH && (glyphs[(skip + i) / DISPLAY_CURSOR_OFFSET_X][k] & (1 << (top + j))))
+				{
+					Display_PutPixel(display, x + i, y + j, display->currentDrawColor);
+				}
+			}
+		}
+
+		return;
+	}
+
+	for(j = 0; j < height; )	/* One zone, or two when the run crosses the RAM wrap */
+	{
+		rows = Display_ZoneRows(display, y + j, height - j);
+
+		Display_SetDrawZone(display, x, y + j, width, rows);
+
+		Display_Begin(display);
+
+		DISPLAY_STAT_ADD(display, dataBytes, (uint32_t)width * rows * 2);
+
+		for(; rows; rows--, j++)
+		{
+			Display_GlyphRow(display, glyphs, skip, top + j, width, line);
+
+			display->transport->writePixels(display, line, width);
+		}
+
+		Display_End(display);
+	}
+#endif
+}
+
+
+/*
+ *	@brief	Draw ASCII char
+ *		The char fills a DISPLAY_CURSOR_OFFSET_X x DISPLAY_CURSOR_OFFSET_Y cell, see Display_DrawTextRun
+ * 
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Char x coordinate
+ *	@param	Char y coordinate
+ *	@param	ASCII char
+ * 
+ *	@retval none
+ */
+void Display_DrawAsciiChar(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t asciiChr)
+{
+	Display_DrawTextRun(display, x, y, &asciiChr, 1);
+}
+
+
+/*
+ *	@brief	Set display cursor.
+ *		When calling the Display_drawAsciiChar() function, 
+ *		the character will be displayed at the specified coordinates
+ * 
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Cursor x coordinate
+ *	@param  Cursor y coordinate
+ * 
+ *  @retval	none
+ */
+void Display_SetCursor(struct SSD1351 *display, uint8_t x, uint8_t y)
+{
+	if(x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT) return;
+
+	display->cursorX = x;
+	display->cursorY = y;
+}
+
+/*
+ *	@brief	Displays a line starting from the current cursor position
+ * 
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	String
+ * 
+ *	@retval none
+ */
+void Display_PrintString(struct SSD1351 *display, char str[])
+{
+	uint8_t count = 0;
+
+	if(display->cursorX >= DISPLAY_WIDTH || display->cursorY >= DISPLAY_HEIGHT) return;
+
+	while(str[count] != 0 && display->cursorX + count * DISPLAY_CURSOR_OFFSET_X < DISPLAY_WIDTH)	/* Chars that start on the screen */
+	{
+		count++;
+	}
+
+	Display_DrawTextRun(display, display->cursorX, display->cursorY, (const uint8_t *)str, count);	/* The whole line is one window */
+
+	display->cursorX += count * DISPLAY_CURSOR_OFFSET_X;	/* Move the cursor to the right */
+}
+
+
+#define DISPLAY_FMT_LEFT	0x01	/* '-': pad on the right */
+#define DISPLAY_FMT_ZERO	0x02	/* '0': pad with zeros after the sign */
+#define DISPLAY_FMT_PLUS	0x04	/* '+': sign positive numbers */
+#define DISPLAY_FMT_SPACE	0x08	/* ' ': blank in place of the plus */
+#define DISPLAY_FMT_UPPER	0x10	/* %X */
+#define DISPLAY_FMT_LONG	0x20	/* l length modifier */
+
+#define DISPLAY_FMT_SIGN(flags)	((flags) & DISPLAY_FMT_PLUS ? '+' : (flags) & DISPLAY_FMT_SPACE ? ' ' : 0)
+
+#define DISPLAY_FMT_MAX_PRECISION	9	/* Fraction digits of %f, 10^9 still fits 32 bits */
+
+/*
+ *	@brief	Formatted text on its way to the glyph path
+ *		Characters are collected while they start on the screen and drawn as one run at the cursor
+ */
+struct Display_TextOut
+{
+	struct SSD1351 *display;
+	uint8_t line[DISPLAY_WIDTH / DISPLAY_CURSOR_OFFSET_X + 1];
+	uint8_t count;
+};
+
+
+/*
+ *	@brief	Draw the collected characters at the cursor and move it past them
+ *
+ *	@param	Text output
+ *
+ *	@retval none
+ */
+static void Display_OutFlush( struct Display_TextOut * out )
+{
+	if(out->count == 0) return;
+
+	Display_DrawTextRun(out->display, out->display->cursorX, out->display->cursorY, out->line, out->count);
+
+	out->display->cursorX += out->count * DISPLAY_CURSOR_OFFSET_X;
+	out->count = 0;
+}
+
+
+/*
+ *	@brief	Add a character to the text output
+ *		'\n' moves the cursor to the start of the next text row, characters past the right edge are dropped
+ *
+ *	@param	Text output
+ *	@param	Character
+ *
+ *	@retval none
+ */
+static void Display_OutChar( struct Display_TextOut * out, uint8_t chr )
+{
+	struct SSD1351 *display = out->display;
+
+	if(chr == '\n')
+	{
+		Display_OutFlush(out);
+
+		display->cursorX = 0;
+		display->cursorY += DISPLAY_CURSOR_OFFSET_Y;
+		return;
+	}
+
+	if(display->cursorX + out->count * DISPLAY_CURSOR_OFFSET_X < DISPLAY_WIDTH) out->line[out->count++] = chr;
+}
+
+
+/*
+ *	@brief	Add a padded field to the text output: blanks, sign, zeros, text, blanks
+ *
+ *	@param	Text output
+ *	@param	Text
+ *	@param	Text length
+ *	@param	Sign character, 0 - none
+ *	@param	Zeros between the sign and the text
+ *	@param	Minimum field width
+ *	@param	DISPLAY_FMT_... flags
+ *
+ *	@retval none
+ */
+static void Display_OutField( struct Display_TextOut * out, const uint8_t * text, uint8_t length, uint8_t sign, uint8_t zeros,
+		uint8_t width, uint8_t flags )
+{
+	uint16_t used = length + zeros + (sign != 0);
+	uint8_t pad = width > used ? width - used : 0;
+
+	if((flags & (DISPLAY_FMT_ZERO | DISPLAY_FMT_LEFT)) == DISPLAY_FMT_ZERO)
+	{
+		zeros += pad;
+		pad = 0;
+	}
+
+	if(!(flags & DISPLAY_FMT_LEFT))
+	{
+		for(; pad; pad--) Display_OutChar(out, ' ');
+	}
+
+	if(sign) Display_OutChar(out, sign);
+
+	for(; zeros; zeros--) Display_OutChar(out, '0');
+
+	for(; length; length--) Display_OutChar(out, *text++);
+
+	for(; pad; pad--) Display_OutChar(out, ' ');
+}
+
+
+/*
+ *	@brief	Add an unsigned number to the text output
+ *		Digits come out of integer division by a constant, which the compiler turns into multiplies
+ *
+ *	@param	Text output
+ *	@param	Magnitude
+ *	@param	10 or 16
+ *	@param	Sign character, 0 - none
+ *	@param	Minimum number of digits, -1 - not given
+ *	@param	Minimum field width
+ *	@param	DISPLAY_FMT_... flags
+ *
+ *	@retval none
+ */
+static void Display_OutNumber( struct Display_TextOut * out, uint32_t value, uint8_t base, uint8_t sign, int16_t precision,
+		uint8_t width, uint8_t flags )
+{
+	const char *digits = flags & DISPLAY_FMT_UPPER ? "0123456789ABCDEF" : "0123456789abcdef";
+	uint8_t text[10];	/* 4294967295 */
+	uint8_t i = sizeof(text);
+
+	if(precision >= 0) flags &= ~DISPLAY_FMT_ZERO;	/* The precision gives the zeros */
+
+	if(value || precision != 0)	/* Zero with precision 0 has no digits */
+	{
+		do
+		{
+			if(base == 16)
+			{
+				text[--i] = digits[value & 0x0F];
+				value >>= 4;
+			}
+			else
+			{
+				text[--i] = digits[value % 10];
+				value /= 10;
+			}
+		}
+		while(value);
+	}
+
+	precision = precision > (int16_t)(sizeof(text) - i) ? precision - (sizeof(text) - i) : 0;
+
+	Display_OutField(out, &text[i], sizeof(text) - i, sign, (uint8_t)precision, width, flags);
+}
+
+
+/*
+ *	@brief	Add a fixed point number to the text output
+ *		The double is taken apart into sign, exponent and mantissa, the integer part and the
+ *		fraction scaled by 10^precision (rounded half up once) are worked out with integer
+ *		shifts and multiplies, so no floating point helpers are linked in
+ *
+ *	@param	Text output
+ *	@param	Bits of the IEEE 754 double, the integer part must be below 2^32 ("ovf" otherwise)
+ *	@param	Fraction digits, -1 - not given (6)
+ *	@param	Minimum field width
+ *	@param	DISPLAY_FMT_... flags
+ *
+ *	@retval none
+ */
+static void Display_OutFixed( struct Display_TextOut * out, uint64_t value, int16_t precision, uint8_t width, uint8_t flags )
+{
+	static const uint32_t scale[DISPLAY_FMT_MAX_PRECISION + 1] =
+	{
+		1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+	};
+
+	uint8_t text[10 + 1 + DISPLAY_FMT_MAX_PRECISION];	/* Integer part, point, fraction */
+	uint8_t sign = DISPLAY_FMT_SIGN(flags);
+	uint8_t i = sizeof(text);
+	uint16_t exponent = (uint16_t)(value >> 52) & 0x7FF;
+	uint64_t mantissa = value & 0xFFFFFFFFFFFFFULL;
+	uint64_t integer = 0, fraction = 0, low, high;
+	uint32_t whole, part;	/* Digits are cut from 32 bit values, 64 bit division would need a helper too */
+	uint16_t shift;
+	uint8_t digits;
+
+	if(precision < 0) precision = 6;
+	if(precision > DISPLAY_FMT_MAX_PRECISION) precision = DISPLAY_FMT_MAX_PRECISION;
+
+	if((value >> 63) && (exponent || mantissa) && !(exponent == 0x7FF && mantissa)) sign = '-';	/* Not for -0 and NaN */
+
+	if(exponent == 0x7FF || exponent >= 1023 + 32)	/* NaN, infinite or the integer part has more than 32 bits */
+	{
+		Display_OutField(out, (const uint8_t *)(exponent != 0x7FF ? "ovf" : mantissa ? "nan" : "inf"), 3, sign, 0, width, flags & ~DISPLAY_FMT_ZERO);
+		return;
+	}
+
+	shift = 1075 - exponent;	/* value = mantissa * 2^-shift, at least 21 below 2^32 */
+
+	if(exponent && shift < 85)	/* Subnormals and smaller values round to 0 at any precision */
+	{
+		mantissa |= 1ULL << 52;
+
+		if(shift < 64)
+		{
+			integer = mantissa >> shift;
+			mantissa &= (1ULL << shift) - 1;	/* Fraction bits */
+		}
+
+		/* mantissa * 10^precision is up to 83 bits: high holds it shifted down by 32 */
+		low = (uint64_t)(uint32_t)mantissa * scale[precision];
+		high = (uint64_t)(uint32_t)(mantissa >> 32) * scale[precision] + (low >> 32);
+
+		if(shift <= 32) fraction = (low + (1ULL << (shift - 1))) >> shift;	/* The product fits 62 bits */
+		else fraction = (high + (1ULL << (shift - 33))) >> (shift - 32);
+	}
+
+	if(fraction >= scale[precision])	/* Rounded up into the integer part */
+	{
+		fraction -= scale[precision];
+		integer++;
+	}
+
+	if(integer > 0xFFFFFFFFUL)
+	{
+		Display_OutField(out, (const uint8_t *)"ovf", 3, sign, 0, width, flags & ~DISPLAY_FMT_ZERO);
+		return;
+	}
+
+	whole = (uint32_t)integer;
+	part = (uint32_t)fraction;
+
+	for(digits = precision; digits; digits--)
+	{
+		text[--i] = '0' + part % 10;
+		part /= 10;
+	}
+
+	if(precision) text[--i] = '.';
+
+	do
+	{
+		text[--i] = '0' + whole % 10;
+		whole /= 10;
+	}
+	while(whole);
+
+	Display_OutField(out, &text[i], sizeof(text) - i, sign, 0, width, flags);
+}
+
+
+/*
+ *	@brief	Print a signed integer of 32 bits starting from the current cursor position
+ *		The number is drawn as one text run
+ *	
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Number
+ * 
+ *	@retval	none
+ */
+void Display_PrintNum(struct SSD1351 *display, int32_t num)
+{
+	struct Display_TextOut out = { .display = display, .count = 0 };
+
+	Display_OutNumber(&out, num < 0 ? 0u - (uint32_t)num : (uint32_t)num, 10, num < 0 ? '-' : 0, -1, 0, 0);
+	Display_OutFlush(&out);
+}
+
+
+/*
+ *	@brief	Implementation of the printf function for displaying formatted text on the display
+ *		Supports %d %i %u %x %X %c %s %f %% with the - 0 + and space flags, width and
+ *		precision (both may be *) and the l length modifier. Text starts at the cursor,
+ *		'\n' moves it to the next text row. Nothing is allocated, no libc formatting is used
+ *
+ *	@note	%f prints integer parts below 2^32 with up to 9 fraction digits
+ * 
+ *	@param	Ptr to the display struct
+ *	@param	Format
+ *	@param	Arg list
+ * 
+ *	@retval	none
+ */
+void Display_Printf(struct SSD1351 *display, const char *format, ...)
+{
+	struct Display_TextOut out = { .display = display, .count = 0 };
+	const char *str;
+	va_list args;
+	int32_t number;
+	uint32_t value;
+	double real;
+	uint64_t bits;
+	int16_t precision;
+	uint16_t width;
+	uint8_t flags, length, chr;
+
+	va_start(args, format);
+
+	while(*format)
+	{
+		chr = *format++;
+
+		if(chr != '%')
+		{
+			Display_OutChar(&out, chr);
+			continue;
+		}
+
+		for(flags = 0; ; format++)	/* Flags */
+		{
+			if(*format == '-') flags |= DISPLAY_FMT_LEFT;
+			else if(*format == '0') flags |= DISPLAY_FMT_ZERO;
+			else if(*format == '+') flags |= DISPLAY_FMT_PLUS;
+			else if(*format == ' ') flags |= DISPLAY_FMT_SPACE;
+			else break;
+		}
+
+		width = 0;
+
+		if(*format == '*')
+		{
+			number = va_arg(args, int);
+			format++;
+
+			if(number < 0)
+			{
+				flags |= DISPLAY_FMT_LEFT;
+				number = -number;
+			}
+
+			width = number;
+		}
+
+		for(; *format >= '0' && *format <= '9'; format++)
+		{
+			width = width * 10 + (*format - '0');
+		}
+
+		if(width > 255) width = 255;
+
+		precision = -1;
+
+		if(*format == '.')
+		{
+			format++;
+			precision = 0;
+
+			if(*format == '*')
+			{
+				number = va_arg(args, int);
+				format++;
+
+				precision = number < 0 ? -1 : number > 255 ? 255 : number;
+			}
+
+			for(; *format >= '0' && *format <= '9'; format++)
+			{
+				precision = precision * 10 + (*format - '0');
+
+				if(precision > 255) precision = 255;
+			}
+		}
+
+		for(; *format == 'l' || *format == 'h'; format++)	/* Short arguments arrive as int */
+		{
+			if(*format == 'l') flags |= DISPLAY_FMT_LONG;
+		}
+
+		switch(*format)
+		{
+		case 'd':
+		case 'i':
+			number = flags & DISPLAY_FMT_LONG ? (int32_t)va_arg(args, long) : va_arg(args, int);
+
+			Display_OutNumber(&out, number < 0 ? 0u - (uint32_t)number : (uint32_t)number, 10,
+					number < 0 ? '-' : DISPLAY_FMT_SIGN(flags), precision, width, flags);
+			break;
+
+		case 'X':
+			flags |= DISPLAY_FMT_UPPER;
+			/* fall through */
+		case 'u':
+		case 'x':
+			value = flags & DISPLAY_FMT_LONG ? (uint32_t)va_arg(args, unsigned long) : va_arg(args, unsigned int);
+
+			Display_OutNumber(&out, value, *format == 'u' ? 10 : 16, 0, precision, width, flags);
+			break;
+
+		case 'c':
+			chr = (uint8_t)va_arg(args, int);
+
+			Display_OutField(&out, &chr, 1, 0, 0, width, flags & ~DISPLAY_FMT_ZERO);
+			break;
+
+		case 's':
+			str = va_arg(args, const char *);
+
+			for(length = 0; length < 255 && (precision < 0 || length < precision) && str[length]; length++);
+
+			Display_OutField(&out, (const uint8_t *)str, length, 0, 0, width, flags & ~DISPLAY_FMT_ZERO);
+			break;
+
+		case 'f':
+		case 'F':
+			real = va_arg(args, double);
+			memcpy(&bits, &real, sizeof(bits));	/* Only the bits are looked at, see Display_OutFixed */
+
+			Display_OutFixed(&out, bits, precision, width, flags);
+			break;
+
+		case 0:		/* Format ends inside the conversion */
+			format--;
+			break;
+
+		default:	/* %% and unknown conversions print the character */
+			Display_OutChar(&out, *format);
+			break;
+		}
+
+		format++;
+	}
+
+	va_end(args);
+
+	Display_OutFlush(&out);
+}
+
+
+#if defined(DISPLAY_USE_CONSOLE)
+
+/*
+ *	@brief	Move the console cursor to the start of the next line
+ *		On the last line the oldest line is reused and the screen scrolls by one cell
+ *		through the display start line, so only the new empty line is sent
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+static void Display_ConsoleNewLine( struct SSD1351 * display )
+{
+	struct Display_Console *console = &display->console;
+
+	console->column = 0;
+
+	if(console->row < DISPLAY_CONSOLE_ROWS - 1)
+	{
+		console->row++;
+		return;
+	}
+
+	memset(console->cells[console->top], 0, DISPLAY_CONSOLE_COLUMNS);	/* Oldest line becomes the bottom one */
+	console->top = (console->top + 1) % DISPLAY_CONSOLE_ROWS;
+
+	Display_ScrollV(display, DISPLAY_CURSOR_OFFSET_Y);
+}
+
+
+/*
+ *	@brief	Write a character to the console
+ *		'\n' - new line, '\r' - start of the line, '\t' - next tab stop, '\b' - one cell back.
+ *		Other control characters are ignored, a full line wraps on the next character
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Character
+ *
+ *	@retval none
+ */
+void Display_ConsolePutChar(struct SSD1351 *display, uint8_t asciiChr)
+{
+	struct Display_Console *console = &display->console;
+
+	switch(asciiChr)
+	{
+	case '\n':
+		Display_ConsoleNewLine(display);
+		break;
+
+	case '\r':
+		console->column = 0;
+		break;
+
+	case '\t':
+		console->column = (console->column / DISPLAY_CONSOLE_TAB + 1) * DISPLAY_CONSOLE_TAB;
+
+		if(console->column > DISPLAY_CONSOLE_COLUMNS) console->column = DISPLAY_CONSOLE_COLUMNS;
+		break;
+
+	case '\b':
+		if(console->column) console->column--;
+		break;
+
+	default:
+		if(asciiChr < 0x20) break;
+
+		if(console->column >= DISPLAY_CONSOLE_COLUMNS) Display_ConsoleNewLine(display);
+
+		console->cells[(console->top + console->row) % DISPLAY_CONSOLE_ROWS][console->column] = asciiChr;
+
+		Display_DrawAsciiChar(display, console->column * DISPLAY_CURSOR_OFFSET_X, console->row * DISPLAY_CURSOR_OFFSET_Y, asciiChr);
+
+		console->column++;
+		break;
+	}
+}
+
+
+/*
+ *	@brief	Write a string to the console
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	String
+ *
+ *	@retval none
+ */
+void Display_ConsolePrint(struct SSD1351 *display, const char *str)
+{
+	while(*str)
+	{
+		Display_ConsolePutChar(display, *str++);
+	}
+}
+
+
+/*
+ *	@brief	Empty the console and fill the screen with currentBackColor
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+void Display_ConsoleClear(struct SSD1351 *display)
+{
+	memset(&display->console, 0, sizeof(display->console));
+
+	Display_Fill(display, display->currentBackColor);
+}
+
+
+/*
+ *	@brief	Draw the whole console again from its cells
+ *		Use it after something else was drawn over the console
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+void Display_ConsoleRedraw(struct SSD1351 *display)
+{
+	struct Display_Console *console = &display->console;
+	const uint8_t *line;
+	uint8_t row, column;
+
+	Display_Fill(display, display->currentBackColor);
+
+	for(row = 0; row < DISPLAY_CONSOLE_ROWS; row++)
+	{
+		line = console->cells[(console->top + row) % DISPLAY_CONSOLE_ROWS];
+
+		for(column = 0; column < DISPLAY_CONSOLE_COLUMNS; column++)
+		{
+			if(line[column])
+			{
+				Display_DrawAsciiChar(display, column * DISPLAY_CURSOR_OFFSET_X, row * DISPLAY_CURSOR_OFFSET_Y, line[column]);
+			}
+		}
+	}
+}
+
+#endif /* DISPLAY_USE_CONSOLE */
+
+
+/*
+ *	@brief	Draw a frame with the specified size at the specified coordinates
+ * 
+ *	@note	The border color is set by the currentDrawColor value, 
+ *		call the Display_setDrawColor function to change it
+ * 
+ *		If the value of xbmDrawMode > 0, 
+ *		then the frame will completely block the previously drawn image
+ * 
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Frame top left corner x coordinate
+ *	@param	Frame top left corner y coordinate
+ *	@param	Frame width
+ *	@param	Frame height
+ *	
+ *	@retval	none
+ */
+void Display_DrawFrame(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+	struct Display_Rect box;
+
+	if(!Display_ClipBox(display, x, y, width, height, &box)) return;	/* Clip the frame once, then each edge */
+
+	DISPLAY_RECORD(display, DISPLAY_OP_FRAME, x, y, width, height, NULL, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	if(display->drawMode == DISPLAY_DRAW_MODE_OVERRIDE && width > 2 && height > 2)
+	{
+		Display_FillClipped(display, x + 1, y + 1, width - 2, height - 2, display->currentBackColor);
+	}
+
+	Display_FillClipped(display, x, y, width, 1, display->currentDrawColor);	/* Top */
+
+	if(height > 1) Display_FillClipped(display, x, y + height - 1, width, 1, display->currentDrawColor);	/* Bottom */
+
+	if(height > 2)
+	{
+		Display_FillClipped(display, x, y + 1, 1, height - 2, display->currentDrawColor);	/* Left */
+
+		if(width > 1) Display_FillClipped(display, x + width - 1, y + 1, 1, height - 2, display->currentDrawColor);	/* Right */
+	}
+}
+
+
+/*
+ *	@brief	Draw a rectangle of the specified dimensions at the specified coordinates
+ *	
+ *	@note	The box color is set by the currentDrawColor value, 
+ *		call the Display_setDrawColor function to change it
+ * 
+  *	@param	Ptr to the SSD1351 struct
+ *	@param	Box top left corner x coordinate
+ *	@param	Box top left corner y coordinate
+ *	@param	Box width
+ *	@param	Box height
+ * 
+ *	@retval none
+ */
+void Display_DrawBox(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+	struct Display_Rect box;
+
+	if(!Display_ClipBox(display, x, y, width, height, &box)) return;	/* Clip the box once */
+
+	DISPLAY_RECORD(display, DISPLAY_OP_BOX, x, y, width, height, NULL, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	Display_FillRect(display, box.x0, box.y0, box.x1 - box.x0 + 1, box.y1 - box.y0 + 1, display->currentDrawColor);
+}
+
+
+#define DISPLAY_ROUND_EDGE	(int16_t)-0x4000	/* No row further out: every pixel of the row is edge */
+
+/*
+ *	@brief	Draw rows of a rounded shape: columns x0 - dx .. x1 + dx, or only the edges of them.
+ *		The inside of an outline (x0 - inner .. x1 + inner) gets the back color in OVERRIDE mode
+ *		and stays untouched otherwise
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Left center x, drawing coordinates
+ *	@param	Right center x
+ *	@param	Top row
+ *	@param	Rows
+ *	@param	Half width: the rows cover x0 - dx .. x1 + dx
+ *	@param	Half width of the inside, DISPLAY_ROUND_EDGE - the whole row is edge
+ *	@param	1 - filled, 0 - outline
+ *
+ *	@retval none
+ */
+static void Display_RoundRow( struct SSD1351 * display, int16_t x0, int16_t x1, int16_t y, uint16_t height, int16_t dx, int16_t inner, uint8_t filled )
+{
+	if(filled || x1 - x0 + 2 * inner + 1 <= 0)
+	{
+		Display_FillClipped(display, x0 - dx, y, x1 - x0 + 2 * dx + 1, height, display->currentDrawColor);
+		return;
+	}
+
+	Display_FillClipped(display, x0 - dx, y, dx - inner, height, display->currentDrawColor);	/* Left edge */
+	Display_FillClipped(display, x1 + inner + 1, y, dx - inner, height, display->currentDrawColor);	/* Right edge */
+
+	if(display->drawMode == DISPLAY_DRAW_MODE_OVERRIDE)
+	{
+		Display_FillClipped(display, x0 - inner, y, x1 - x0 + 2 * inner + 1, height, display->currentBackColor);
+	}
+}
+
+
+/*
+ *	@brief	Draw a rounded shape as horizontal spans, every pixel is written once
+ *		The corners are quarter ellipses around (x0, y0), (x1, y0), (x0, y1) and (x1, y1): an ellipse
+ *		when the centers meet, a rounded rectangle otherwise. A pixel is inside when
+ *		(dx / (a + 1/2))^2 + (dy / (b + 1/2))^2 <= 1, the test is stepped from row to row with additions
+ *		(midpoint style). The outline is made of the inside pixels with a neighbor outside
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Left center x, drawing coordinates
+ *	@param	Top center y
+ *	@param	Right center x
+ *	@param	Bottom center y
+ *	@param	Horizontal radius
+ *	@param	Vertical radius
+ *	@param	1 - filled, 0 - outline
+ *
+ *	@retval none
+ */
+static void Display_RoundSpans( struct SSD1351 * display, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t a, uint8_t b, uint8_t filled )
+{
+	int32_t ax = (2 * a + 1) * (2 * a + 1);	/* Doubled radii squared */
+	int32_t by = (2 * b + 1) * (2 * b + 1);
+	int64_t test = 4 * (int64_t)by + 4 * (int64_t)b * b * ax - (int64_t)ax * by;	/* > 0: pixel (dx + 1, dy) is outside */
+	int16_t dx = 0, outer = DISPLAY_ROUND_EDGE;	/* Half widths of the row and of the row further out */
+	int16_t dy;
+
+	for(dy = b; dy >= 0; dy--)
+	{
+		while(test <= 0)
+		{
+			test += 4 * (int64_t)by * (2 * dx + 3);
+			dx++;
+		}
+
+		if(dy == 0) break;
+
+		Display_RoundRow(display, x0, x1, y0 - dy, 1, dx, outer < dx - 1 ? outer : dx - 1, filled);
+		Display_RoundRow(display, x0, x1, y1 + dy, 1, dx, outer < dx - 1 ? outer : dx - 1, filled);
+
+		outer = dx;
+		test += 4 * (int64_t)ax * (1 - 2 * dy);
+	}
+
+	Display_RoundRow(display, x0, x1, y0, 1, dx, outer < dx - 1 ? outer : dx - 1, filled);	/* Straight part */
+
+	if(y1 > y0)
+	{
+		if(y1 > y0 + 1) Display_RoundRow(display, x0, x1, y0 + 1, y1 - y0 - 1, dx, dx - 1, filled);
+
+		Display_RoundRow(display, x0, x1, y1, 1, dx, outer < dx - 1 ? outer : dx - 1, filled);
+	}
+}
+
+
+/*
+ *	@brief	Draw an ellipse outline
+ *
+ *	@note	The outline color is set by the currentDrawColor value. In OVERRIDE mode the inside is filled with currentBackColor
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Center x coordinate
+ *	@param	Center y coordinate
+ *	@param	Horizontal radius
+ *	@param	Vertical radius
+ *
+ *	@retval none
+ */
+void Display_DrawEllipse(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t rx, uint8_t ry)
+{
+	struct Display_Rect box;
+
+	if(!Display_ClipBox(display, x - rx, y - ry, 2 * rx + 1, 2 * ry + 1, &box)) return;
+
+	DISPLAY_RECORD(display, DISPLAY_OP_ELLIPSE, x, y, rx, ry, NULL, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	Display_RoundSpans(display, x, y, x, y, rx, ry, 0);
+}
+
+
+/*
+ *	@brief	Draw a filled ellipse
+ *
+ *	@note	The color is set by the currentDrawColor value
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Center x coordinate
+ *	@param	Center y coordinate
+ *	@param	Horizontal radius
+ *	@param	Vertical radius
+ *
+ *	@retval none
+ */
+void Display_DrawFilledEllipse(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t rx, uint8_t ry)
+{
+	struct Display_Rect box;
+
+	if(!Display_ClipBox(display, x - rx, y - ry, 2 * rx + 1, 2 * ry + 1, &box)) return;
+
+	DISPLAY_RECORD(display, DISPLAY_OP_FILLED_ELLIPSE, x, y, rx, ry, NULL, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	Display_RoundSpans(display, x, y, x, y, rx, ry, 1);
+}
+
+
+/*
+ *	@brief	Draw a circle outline, see Display_DrawEllipse
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Center x coordinate
+ *	@param	Center y coordinate
+ *	@param	Radius
+ *
+ *	@retval none
+ */
+void Display_DrawCircle(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t r)
+{
+	Display_DrawEllipse(display, x, y, r, r);
+}
+
+
+/*
+ *	@brief	Draw a filled circle, see Display_DrawFilledEllipse
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Center x coordinate
+ *	@param	Center y coordinate
+ *	@param	Radius
+ *
+ *	@retval none
+ */
+void Display_DrawDisc(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t r)
+{
+	Display_DrawFilledEllipse(display, x, y, r, r);
+}
+
+
+/*
+ *	@brief	Draw a frame with rounded corners
+ *
+ *	@note	The border color is set by the currentDrawColor value. In OVERRIDE mode the inside is filled with currentBackColor
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Frame top left corner x coordinate
+ *	@param	Frame top left corner y coordinate
+ *	@param	Frame width
+ *	@param	Frame height
+ *	@param	Corner radius, limited to half the shorter side
+ *
+ *	@retval none
+ */
+void Display_DrawRFrame(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t r)
+{
+	struct Display_Rect box;
+
+	if(!Display_ClipBox(display, x, y, width, height, &box)) return;
+
+	DISPLAY_RECORD(display, DISPLAY_OP_RFRAME, x, y, width, height, &r, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	if(r > (width - 1) / 2) r = (width - 1) / 2;
+	if(r > (height - 1) / 2) r = (height - 1) / 2;
+
+	Display_RoundSpans(display, x + r, y + r, x + width - 1 - r, y + height - 1 - r, r, r, 0);
+}
+
+
+/*
+ *	@brief	Draw a box with rounded corners
+ *
+ *	@note	The box color is set by the currentDrawColor value
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Box top left corner x coordinate
+ *	@param	Box top left corner y coordinate
+ *	@param	Box width
+ *	@param	Box height
+ *	@param	Corner radius, limited to half the shorter side
+ *
+ *	@retval none
+ */
+void Display_DrawRBox(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t r)
+{
+	struct Display_Rect box;
+
+	if(!Display_ClipBox(display, x, y, width, height, &box)) return;
+
+	DISPLAY_RECORD(display, DISPLAY_OP_RBOX, x, y, width, height, &r, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	if(r > (width - 1) / 2) r = (width - 1) / 2;
+	if(r > (height - 1) / 2) r = (height - 1) / 2;
+
+	Display_RoundSpans(display, x + r, y + r, x + width - 1 - r, y + height - 1 - r, r, r, 1);
+}
+
+
+/*
+ *	@brief	Widen the row extents of a convex shape by the pixels of one edge
+ *		The edge is walked with the steps of Display_Line, so the fill covers the outline exactly
+ *
+ *	@param	Clip rectangle, only its rows are kept
+ *	@param	Leftmost pixel met on each row, INT16_MAX for none
+ *	@param	Rightmost pixel met on each row
+ *	@param	Start x in screen coordinates
+ *	@param	Start y
+ *	@param	End x
+ *	@param	End y
+ *
+ *	@retval none
+ */
+static void Display_ScanEdge( const struct Display_Rect * clip, int16_t * left, int16_t * right, int16_t x, int16_t y, int16_t endX, int16_t endY )
+{
+	int16_t deltaX = abs(endX - x);
+	int16_t deltaY = abs(endY - y);
+	int16_t stepX = x < endX ? 1 : -1;
+	int16_t stepY = y < endY ? 1 : -1;
+	int16_t major = deltaY > deltaX ? deltaY : deltaX;
+	int16_t minor = deltaY > deltaX ? deltaX : deltaY;
+	int16_t error = major - 1, i;
+
+	if((y < clip->y0 && endY < clip->y0) || (y > clip->y1 && endY > clip->y1)) return;
+
+	for(i = 0; ; i++)
+	{
+		if(y >= clip->y0 && y <= clip->y1)
+		{
+			if(x < left[y]) left[y] = x;
+			if(x > right[y]) right[y] = x;
+		}
+
+		if(i == major) break;
+
+		error += 2 * minor;
+
+		if(deltaY > deltaX)
+		{
+			y += stepY;
+
+			if(error >= 2 * major)
+			{
+				error -= 2 * major;
+				x += stepX;
+			}
+		}
+		else
+		{
+			x += stepX;
+
+			if(error >= 2 * major)
+			{
+				error -= 2 * major;
+				y += stepY;
+			}
+		}
+	}
+}
+
+
+/*
+ *	@brief	Fill one span per clip row between the extents found by Display_ScanEdge
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Leftmost pixel of each row
+ *	@param	Rightmost pixel of each row
+ *	@param	Fill color
+ *
+ *	@retval none
+ */
+static void Display_FillScan( struct SSD1351 * display, const int16_t * left, const int16_t * right, uint16_t color )
+{
+	const struct Display_Rect *clip = &display->clip;
+	int16_t x, endX, y;
+
+	for(y = clip->y0; y <= clip->y1; y++)
+	{
+		x = left[y] > clip->x0 ? left[y] : clip->x0;
+		endX = right[y] < clip->x1 ? right[y] : clip->x1;
+
+		if(x <= endX) Display_FillRect(display, x, y, endX - x + 1, 1, color);
+	}
+}
+
+
+/*
+ *	@brief	Fill a convex polygon, one span per row from its leftmost to its rightmost edge pixel
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Corners: x0, y0, x1, y1... in drawing coordinates
+ *	@param	Number of corners
+ *	@param	Fill color
+ *
+ *	@retval none
+ */
+static void Display_FillPolygon( struct SSD1351 * display, const uint8_t * points, uint8_t count, uint16_t color )
+{
+	const struct Display_Rect *clip = &display->clip;
+	int16_t left[DISPLAY_HEIGHT], right[DISPLAY_HEIGHT];	/* Edge pixels met on each row of the clip */
+	int16_t y;
+	uint8_t k, next;
+
+	for(y = clip->y0; y <= clip->y1; y++)
+	{
+		left[y] = INT16_MAX;
+		right[y] = INT16_MIN;
+	}
+
+	for(k = 0; k < count; k++)
+	{
+		next = k + 1 < count ? k + 1 : 0;
+
+		Display_ScanEdge(clip, left, right, points[2 * k] + display->originX, points[2 * k + 1] + display->originY,
+				points[2 * next] + display->originX, points[2 * next + 1] + display->originY);
+	}
+
+	Display_FillScan(display, left, right, color);
+}
+
+
+/*
+ *	@brief	Find the visible part of the box around a polygon
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Corners: x0, y0, x1, y1...
+ *	@param	Number of corners
+ *	@param	Visible part in screen coordinates
+ *
+ *	@retval	1 - some of the polygon may be visible, 0 - none
+ */
+static uint8_t Display_ClipPolygon( struct SSD1351 * display, const uint8_t * points, uint8_t count, struct Display_Rect * box )
+{
+	uint8_t left = 0xFF, top = 0xFF, right = 0, bottom = 0;
+	uint8_t k;
+
+	for(k = 0; k < count; k++)
+	{
+		if(points[2 * k] < left) left = points[2 * k];
+		if(points[2 * k] > right) right = points[2 * k];
+		if(points[2 * k + 1] < top) top = points[2 * k + 1];
+		if(points[2 * k + 1] > bottom) bottom = points[2 * k + 1];
+	}
+
+	return count && Display_ClipBox(display, left, top, right - left + 1, bottom - top + 1, box);
+}
+
+
+/*
+ *	@brief	Draw the outline of a polygon
+ *
+ *	@note	The outline color is set by the currentDrawColor value. In OVERRIDE mode the inside
+ *		of a convex polygon is filled with currentBackColor
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Corners: x0, y0, x1, y1...
+ *	@param	Number of corners, the last one is joined to the first
+ *
+ *	@retval none
+ */
+void Display_DrawPolygon(struct SSD1351 *display, const uint8_t points[], uint8_t count)
+{
+	struct Display_Rect box;
+
+	if(!Display_ClipPolygon(display, points, count, &box)) return;
+
+	DISPLAY_RECORD(display, DISPLAY_OP_POLYGON, count, 0, 0, 0, points, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	if(display->drawMode == DISPLAY_DRAW_MODE_OVERRIDE) Display_FillPolygon(display, points, count, display->currentBackColor);
+
+	Display_Lines(display, points, count, 1);
+}
+
+
+/*
+ *	@brief	Draw a filled convex polygon
+ *
+ *	@note	The color is set by the currentDrawColor value
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Corners: x0, y0, x1, y1...
+ *	@param	Number of corners
+ *
+ *	@retval none
+ */
+void Display_DrawFilledPolygon(struct SSD1351 *display, const uint8_t points[], uint8_t count)
+{
+	struct Display_Rect box;
+
+	if(!Display_ClipPolygon(display, points, count, &box)) return;
+
+	DISPLAY_RECORD(display, DISPLAY_OP_FILLED_POLYGON, count, 0, 0, 0, points, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	Display_FillPolygon(display, points, count, display->currentDrawColor);
+}
+
+
+/*
+ *	@brief	Draw the outline of a triangle, see Display_DrawPolygon
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Corners
+ *
+ *	@retval none
+ */
+void Display_DrawTriangle(struct SSD1351 *display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2)
+{
+	Display_DrawPolygon(display, (const uint8_t []){ x0, y0, x1, y1, x2, y2 }, 3);
+}
+
+
+/*
+ *	@brief	Draw a filled triangle, see Display_DrawFilledPolygon
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Corners
+ *
+ *	@retval none
+ */
+void Display_DrawFilledTriangle(struct SSD1351 *display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2)
+{
+	Display_DrawFilledPolygon(display, (const uint8_t []){ x0, y0, x1, y1, x2, y2 }, 3);
+}
+
+
+/*
+ *	@brief	Draw lines joining a list of points, e.g. the samples of a chart
+ *		Each point is drawn once, so the joints are not blended twice. With bands a line longer
+ *		than DISPLAY_LIST_TEXT / 2 points is recorded as pieces of that many points
+ *
+ *	@note	The line color is set by the currentDrawColor value
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Points: x0, y0, x1, y1...
+ *	@param	Number of points
+ *
+ *	@retval none
+ */
+void Display_DrawPolyline(struct SSD1351 *display, const uint8_t points[], uint8_t count)
+{
+	struct Display_Rect box;
+
+#if defined(DISPLAY_USE_BANDS)
+	for(; count > DISPLAY_LIST_TEXT / 2; points += 2 * (DISPLAY_LIST_TEXT / 2 - 1), count -= DISPLAY_LIST_TEXT / 2 - 1)
+	{
+		Display_DrawPolyline(display, points, DISPLAY_LIST_TEXT / 2);	/* Recorded in pieces that share their end points */
+	}
+#endif
+
+	if(!Display_ClipPolygon(display, points, count, &box)) return;
+
+	DISPLAY_RECORD(display, DISPLAY_OP_POLYLINE, count, 0, 0, 0, points, box.x0, box.y0, box.x1, box.y1);
+
+	Display_Lines(display, points, count, 0);
+}
+
+
+/*
+ *	@brief	Round p / q to the nearest integer, halves away from zero
+ *
+ *	@param	Dividend
+ *	@param	Divisor, > 0
+ *
+ *	@retval	Quotient
+ */
+static int16_t Display_RoundDiv( int32_t p, int32_t q )
+{
+	return (2 * p + (p < 0 ? -q : q)) / (2 * q);
+}
+
+
+/*
+ *	@brief	Integer square root, rounded to the nearest integer
+ *
+ *	@param	Value
+ *
+ *	@retval	Square root
+ */
+static uint16_t Display_Sqrt( uint32_t value )
+{
+	uint32_t root = 0, bit = 1UL << 30, rest = value;
+
+	while(bit > rest) bit >>= 2;
+
+	for(; bit; bit >>= 2)
+	{
+		if(rest >= root + bit)
+		{
+			rest -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+	}
+
+	return (uint16_t)(value - root * root > root ? root + 1 : root);
+}
+
+
+/*
+ *	@brief	Draw a line of some width
+ *		Axis aligned lines are boxes. The others are filled as the parallelogram around the line
+ *		whose ends are cut along the minor axis, so that its width across the line is right,
+ *		one span per row. The extra pixel of an even width goes below or right of the line
+ *
+ *	@note	The line color is set by the currentDrawColor value
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Start x
+ *	@param	Start y
+ *	@param	End x
+ *	@param	End y
+ *	@param	Width in pixels
+ *
+ *	@retval none
+ */
+void Display_DrawThickLine(struct SSD1351 *display, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t width)
+{
+	const struct Display_Rect *clip = &display->clip;
+	int16_t left[DISPLAY_HEIGHT], right[DISPLAY_HEIGHT];	/* Edge pixels met on each row of the clip */
+	int16_t deltaX = x1 - x0, deltaY = y1 - y0;
+	int16_t corners[8], x, y, span;
+	int16_t minX = INT16_MAX, minY = INT16_MAX, maxX = INT16_MIN, maxY = INT16_MIN;
+	uint16_t length;
+	uint8_t k, steep;
+	struct Display_Rect box;
+
+	if(width <= 1)
+	{
+		Display_DrawLine(display, x0, y0, x1, y1);
+		return;
+	}
+
+	if(deltaX == 0 || deltaY == 0)
+	{
+		x = deltaY ? x0 - (width - 1) / 2 : (x0 < x1 ? x0 : x1);
+		y = deltaY ? (y0 < y1 ? y0 : y1) : y0 - (width - 1) / 2;
+
+		if(!Display_ClipBox(display, x, y, deltaY ? width : abs(deltaX) + 1, deltaY ? abs(deltaY) + 1 : width, &box)) return;
+
+		DISPLAY_RECORD(display, DISPLAY_OP_THICK_LINE, x0, y0, x1, y1, &width, box.x0, box.y0, box.x1, box.y1);
+
+		Display_FillRect(display, box.x0, box.y0, box.x1 - box.x0 + 1, box.y1 - box.y0 + 1, display->currentDrawColor);
+		Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+		return;
+	}
+
+	steep = abs(deltaY) > abs(deltaX);
+	length = Display_Sqrt(((int32_t)deltaX * deltaX + (int32_t)deltaY * deltaY) << 8);	/* 1/16 pixels */
+	span = Display_RoundDiv((int32_t)width * length, 16 * (steep ? abs(deltaY) : abs(deltaX)));	/* Across the minor axis */
+
+	x = steep ? (span - 1) / 2 : 0;	/* Offsets to the sides of the line */
+	y = steep ? 0 : (span - 1) / 2;
+
+	corners[0] = x0 - x;
+	corners[1] = y0 - y;
+	corners[2] = x1 - x;
+	corners[3] = y1 - y;
+
+	x = steep ? span / 2 : 0;
+	y = steep ? 0 : span / 2;
+
+	corners[4] = x1 + x;
+	corners[5] = y1 + y;
+	corners[6] = x0 + x;
+	corners[7] = y0 + y;
+
+	for(k = 0; k < 8; k += 2)
+	{
+		if(corners[k] < minX) minX = corners[k];
+		if(corners[k] > maxX) maxX = corners[k];
+		if(corners[k + 1] < minY) minY = corners[k + 1];
+		if(corners[k + 1] > maxY) maxY = corners[k + 1];
+	}
+
+	if(!Display_ClipBox(display, minX, minY, maxX - minX + 1, maxY - minY + 1, &box)) return;
+
+	DISPLAY_RECORD(display, DISPLAY_OP_THICK_LINE, x0, y0, x1, y1, &width, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	for(y = clip->y0; y <= clip->y1; y++)
+	{
+		left[y] = INT16_MAX;
+		right[y] = INT16_MIN;
+	}
+
+	for(k = 0; k < 8; k += 2)
+	{
+		Display_ScanEdge(clip, left, right, corners[k] + display->originX, corners[k + 1] + display->originY,
+				corners[(k + 2) % 8] + display->originX, corners[(k + 3) % 8] + display->originY);
+	}
+
+	Display_FillScan(display, left, right, display->currentDrawColor);
+}
+
+
+/*
+ *	@brief	Draw a monochrome bitmap (XBM)
+ * 
+ *	@note	The XBM color is set by the currentDrawColor value, 
+ *		call the Display_setDrawColor function to change it
+ * 
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	XBM top left corner x coordinate
+ *	@param	XBM top left corner y coordinate
+ *	@param	XBM width
+ *	@param	XBM height	
+ *	@param	XBM array pointer
  * 
  *	@retval none
  */
-void Display_DrawAsciiChar(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t asciiChr)
+void Display_DrawXBM(struct SSD1351 *display, uint8_t xbmStartx, uint8_t xbmStarty, uint8_t xbmWidth, uint8_t xbmHeight, uint8_t xbm[])
+{
+	uint8_t xbmArrayLength;
+	uint8_t visibleWidth, visibleHeight;
+	uint8_t skipX, skipY;
+	uint8_t i;
+	uint8_t j;
+	struct Display_Rect box;
+
+	if(!Display_ClipBox(display, xbmStartx, xbmStarty, xbmWidth, xbmHeight, &box)) return;	/* Clip the bitmap once */
+
+	xbmArrayLength = (xbmWidth / 8) + 1;
+	if((xbmWidth % 8) == 0) xbmArrayLength = (xbmWidth / 8);
+
+	skipX = box.x0 - (xbmStartx + display->originX);
+	skipY = box.y0 - (xbmStarty + display->originY);
+	visibleWidth = box.x1 - box.x0 + 1;
+	visibleHeight = box.y1 - box.y0 + 1;
+
+	DISPLAY_RECORD(display, DISPLAY_OP_XBM, xbmStartx, xbmStarty, xbmWidth, xbmHeight, xbm, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	xbm += skipY * xbmArrayLength;
+
+	for(i = 0; i < visibleHeight; i++, xbm += xbmArrayLength)
+	{
+		for(j = skipX; j < skipX + visibleWidth; j++)
+		{
+			if(xbm[j / 8] & (1 << (j % 8)))
+			{
+				Display_PutPixel(display, box.x0 + j - skipX, box.y0 + i, display->currentDrawColor);
+			}
+		}
+	}
+}
+
+
+#if DISPLAY_HAS_BUFFER || defined(DISPLAY_USE_BANDS)	/* Without either the image goes straight to the display */
+/*
+ *	@brief	Copy a row of image pixels into a 16 bit pixel row
+ *		Images hold RGB565 MSB first, the order Display_Upd sends the 16 bit frames in.
+ *		Opaque rows are swapped two pixels per 32 bit word (little endian core)
+ *
+ *	@param	Destination
+ *	@param	Image pixels
+ *	@param	Pixels
+ *	@param	1 - pixels equal to key are skipped
+ *	@param	Transparent color
+ *
+ *	@retval none
+ */
+static void Display_CopyPixels( uint16_t * dst, const uint8_t * src, uint8_t width, uint8_t keyed, uint16_t key )
+{
+	uint32_t pair;
+	uint16_t color;
+
+	if(keyed)
+	{
+		for(; width; width--, dst++, src += 2)
+		{
+			color = ((uint16_t)src[0] << 8) | src[1];
+
+			if(color != key) *dst = color;
+		}
+
+		return;
+	}
+
+	if(((uintptr_t)dst & 0x02) && width)	/* Align to a word */
+	{
+		*dst++ = ((uint16_t)src[0] << 8) | src[1];
+		src += 2;
+		width--;
+	}
+
+	for(; width >= 2; width -= 2, dst += 2, src += 4)
+	{
+		memcpy(&pair, src, sizeof(pair));	/* Source may be unaligned */
+
+		*(uint32_t *)dst = ((pair >> 8) & 0x00FF00FF) | ((pair << 8) & 0xFF00FF00);
+	}
+
+	if(width) *dst = ((uint16_t)src[0] << 8) | src[1];
+}
+#endif
+
+
+/*
+ *	@brief	Draw a rectangle of an RGB565 image
+ *		The image is clipped once (the source starts at its first visible pixel), then copied row by row: into the frame buffer or the band
+ *		being replayed, or sent as it is through a single draw zone (8 bit frames, the image
+ *		already has the byte order of the display). Transparent pixels can't be skipped inside
+ *		a draw zone, so without a buffer keyed rows are sent as runs of visible pixels
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Destination x
+ *	@param	Destination y
+ *	@param	Width
+ *	@param	Height
+ *	@param	First pixel of the top row
+ *	@param	Bytes between source rows
+ *	@param	1 - pixels equal to key are transparent
+ *	@param	Transparent color
+ *
+ *	@retval none
+ */
+static void Display_BlitIMG( struct SSD1351 * display, uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+		const uint8_t * src, uint16_t stride, uint8_t keyed, uint16_t key )
+{
+	uint8_t visibleWidth, visibleHeight, j;
+	struct Display_Rect box;
+
+	if(!Display_ClipBox(display, x, y, width, height, &box)) return;	/* Clip the image once */
+
+#if defined(DISPLAY_USE_BANDS)
+	if(Display_ListAdd(display, keyed ? DISPLAY_OP_IMG_KEY : DISPLAY_OP_IMG, (const uint8_t []){ x, y, width, height }, src, &box))
+	{
+		display->list[display->listCount - 1].drawColor = stride;
+		display->list[display->listCount - 1].backColor = key;
+		return;
+	}
+#endif
+
+	src += (box.y0 - (y + display->originY)) * stride + (box.x0 - (x + display->originX)) * 2;	/* First visible pixel */
+
+	x = box.x0;
+	y = box.y0;
+	visibleWidth = box.x1 - box.x0 + 1;
+	visibleHeight = box.y1 - box.y0 + 1;
+
+	Display_MarkDirty(display, x, y, box.x1, box.y1);
+
+#if DISPLAY_INDEXED
+	uint16_t line[DISPLAY_WIDTH];
+
+	for(j = 0; j < visibleHeight; j++, src += stride)	/* Pixels are palette indices */
+	{
+		if(keyed) Display_LoadRow(display, x, y + j, visibleWidth, line);
+
+		Display_CopyPixels(line, src, visibleWidth, keyed, key);
+		Display_StoreRow(display, x, y + j, visibleWidth, line);
+	}
+#elif DISPLAY_HAS_BUFFER
+	uint16_t *row = &((uint16_t *)&display->frameBuffer)[DISPLAY_WIDTH * y + x];
+	uint16_t line[DISPLAY_WIDTH];
+
+	for(j = 0; j < visibleHeight; j++, row += DISPLAY_WIDTH, src += stride)
+	{
+		if(display->drawMode == DISPLAY_DRAW_MODE_BLEND)	/* Transparent pixels keep the frame, blending them changes nothing */
+		{
+			if(keyed) memcpy(line, row, visibleWidth * 2);
+
+			Display_CopyPixels(line, src, visibleWidth, keyed, key);
+			Display_BlendLine(row, line, visibleWidth, DISPLAY_ALPHA32(display->alpha));
+		}
+		else
+		{
+			Display_CopyPixels(row, src, visibleWidth, keyed, key);
+		}
+	}
+#else
+	uint16_t i, length;
+	uint8_t rows;
+
+#if defined(DISPLAY_USE_BANDS)
+	if(display->bandRows)	/* Replaying the display list: the rows inside the band */
+	{
+		for(j = 0; j < visibleHeight; j++, src += stride)
+		{
+			rows = y + j - display->bandY;
+
+			if(rows < display->bandRows) Display_CopyPixels(&display->band[DISPLAY_WIDTH * rows + x], src, visibleWidth, keyed, key);
+		}
+
+		return;
+	}
+#endif
+
+	if(keyed)
+	{
+		for(j = 0; j < visibleHeight; j++, src += stride)
+		{
+			for(i = 0; i < visibleWidth; i += length)
+			{
+				for(length = 0; i + length < visibleWidth; length++)	/* Run of visible pixels */
+				{
+					if((((uint16_t)src[(i + length) * 2] << 8) | src[(i + length) * 2 + 1]) == key) break;
+				}
+
+				if(length == 0)
+				{
+					length = 1;	/* Transparent pixel */
+					continue;
+				}
+
+				Display_SetDrawZone(display, x + i, y + j, length, 1);
+				Display_WriteData(display, &src[i * 2], length * 2);
+			}
+		}
+
+		return;
+	}
+
+	for(j = 0; j < visibleHeight; )	/* One zone, or two when the image crosses the RAM wrap */
+	{
+		rows = Display_ZoneRows(display, y + j, visibleHeight - j);
+
+		Display_SetDrawZone(display, x, y + j, visibleWidth, rows);
+
+		Display_Begin(display);
+
+		DISPLAY_STAT_ADD(display, dataBytes, (uint32_t)visibleWidth * rows * 2);
+
+		for(; rows; rows--, j++, src += stride)
+		{
+			display->transport->write(display, src, (uint32_t)visibleWidth * 2);
+		}
+
+		Display_End(display);
+	}
+#endif
+}
+
+
+/*
+ *	@brief	Draw an RGB565 image
+ *
+ *	@note	Pixels are stored MSB first, 2 bytes each. With a palette frame buffer they are palette indices
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Image top left corner x coordinate
+ *	@param	Image top left corner y coordinate
+ *	@param	Image width
+ *	@param	Image height
+ *	@param	Image pixels, row by row
+ *
+ *	@retval none
+ */
+void Display_DrawIMG(struct SSD1351 *display, uint8_t imgStartx, uint8_t imgStarty, uint8_t imgW, uint8_t imgH, uint8_t img[])
+{
+	Display_BlitIMG(display, imgStartx, imgStarty, imgW, imgH, img, (uint16_t)imgW * 2, 0, 0);
+}
+
+
+/*
+ *	@brief	Draw an RGB565 image with a transparent color
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Image top left corner x coordinate
+ *	@param	Image top left corner y coordinate
+ *	@param	Image width
+ *	@param	Image height
+ *	@param	Image pixels, row by row
+ *	@param	Color that is not drawn
+ *
+ *	@retval none
+ */
+void Display_DrawIMGKey(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t imgW, uint8_t imgH, const uint8_t img[], uint16_t key)
+{
+	Display_BlitIMG(display, x, y, imgW, imgH, img, (uint16_t)imgW * 2, 1, key);
+}
+
+
+/*
+ *	@brief	Draw a rectangle of an RGB565 image, e.g. a sprite of a sprite sheet
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Destination x
+ *	@param	Destination y
+ *	@param	Sheet pixels, row by row
+ *	@param	Sheet width
+ *	@param	Rectangle left column in the sheet
+ *	@param	Rectangle top row in the sheet
+ *	@param	Rectangle width
+ *	@param	Rectangle height
+ *
+ *	@retval none
+ */
+void Display_DrawIMGPart(struct SSD1351 *display, uint8_t x, uint8_t y, const uint8_t sheet[], uint8_t sheetW,
+		uint8_t srcX, uint8_t srcY, uint8_t width, uint8_t height)
+{
+	if(srcX >= sheetW) return;
+	if(width > sheetW - srcX) width = sheetW - srcX;
+
+	Display_BlitIMG(display, x, y, width, height, &sheet[((uint32_t)srcY * sheetW + srcX) * 2], (uint16_t)sheetW * 2, 0, 0);
+}
+
+
+/*
+ *	@brief	Draw a rectangle of an RGB565 image with a transparent color
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Destination x
+ *	@param	Destination y
+ *	@param	Sheet pixels, row by row
+ *	@param	Sheet width
+ *	@param	Rectangle left column in the sheet
+ *	@param	Rectangle top row in the sheet
+ *	@param	Rectangle width
+ *	@param	Rectangle height
+ *	@param	Color that is not drawn
+ *
+ *	@retval none
+ */
+void Display_DrawIMGPartKey(struct SSD1351 *display, uint8_t x, uint8_t y, const uint8_t sheet[], uint8_t sheetW,
+		uint8_t srcX, uint8_t srcY, uint8_t width, uint8_t height, uint16_t key)
+{
+	if(srcX >= sheetW) return;
+	if(width > sheetW - srcX) width = sheetW - srcX;
+
+	Display_BlitIMG(display, x, y, width, height, &sheet[((uint32_t)srcY * sheetW + srcX) * 2], (uint16_t)sheetW * 2, 1, key);
+}
+
+
+/*
+ * @brief State of the packed image decoder
+ */
+struct Display_Unpack
+{
+	const uint8_t *src;	/* Next byte of the image */
+	uint16_t color;		/* Last pixel */
+	uint8_t run;		/* Repeats of the last pixel still to come */
+	uint8_t literals;	/* Literal pixels still to come */
+	uint16_t recent[DISPLAY_PACK_RECENT];
+};
+
+
+/*
+ *	@brief	Decode the next pixel of a packed image
+ *
+ *	@param	Decoder state
+ *
+ *	@retval	RGB565 color
+ */
+static inline uint16_t Display_UnpackPixel( struct Display_Unpack * unpack )
+{
+	uint16_t color = unpack->color;
+	uint8_t op;
+
+	if(unpack->run)
+	{
+		unpack->run--;
+		return color;
+	}
+
+	if(unpack->literals == 0)
+	{
+		op = *unpack->src++;
+
+		switch(op & 0xC0)
+		{
+		case DISPLAY_PACK_RUN:
+			unpack->run = op & 0x3F;
+			return color;
+
+		case DISPLAY_PACK_INDEX:
+			return unpack->color = unpack->recent[op & 0x3F];
+
+		case DISPLAY_PACK_DIFF:	/* Components wrap around */
+			color = ((((color >> 11) + ((op >> 4) & 0x03) - 2) & 0x1F) << 11) |
+				((((color >> 5) + ((op >> 2) & 0x03) - 2) & 0x3F) << 5) |
+				(((color & 0x1F) + (op & 0x03) - 2) & 0x1F);
+
+			unpack->recent[DISPLAY_PACK_HASH(color)] = color;
+			return unpack->color = color;
+
+		default:
+			unpack->literals = (op & 0x3F) + 1;
+			break;
+		}
+	}
+
+	unpack->literals--;
+
+	color = ((uint16_t)unpack->src[0] << 8) | unpack->src[1];
+	unpack->src += 2;
+
+	unpack->recent[DISPLAY_PACK_HASH(color)] = color;
+
+	return unpack->color = color;
+}
+
+
+/*
+ *	@brief	Decode a row of a packed image
+ *
+ *	@param	Decoder state
+ *	@param	Destination
+ *	@param	Pixels to decode and drop before the kept ones (clipped part of the row)
+ *	@param	Pixels to keep
+ *	@param	Image width
+ *
+ *	@retval none
+ */
+static void Display_UnpackRow( struct Display_Unpack * unpack, uint16_t * line, uint8_t skip, uint8_t width, uint8_t imgW )
+{
+	uint8_t rest = imgW - skip - width;
+
+	while(skip--)
+	{
+		Display_UnpackPixel(unpack);
+	}
+
+	while(width--)
+	{
+		*line++ = Display_UnpackPixel(unpack);
+	}
+
+	while(rest--)
+	{
+		Display_UnpackPixel(unpack);
+	}
+}
+
+
+/*
+ *	@brief	Draw a packed RGB565 image (see DISPLAY_PACK_... and Host/imgPack)
+ *		The image is decoded row by row straight into the frame buffer, or into a line that
+ *		is streamed through a single draw zone, it is never unpacked as a whole.
+ *		Clipped pixels are decoded and dropped, decoding stops after the last visible row
+ *
+ *	@note	With a palette frame buffer the pixels are palette indices
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Image top left corner x coordinate
+ *	@param	Image top left corner y coordinate
+ *	@param	Packed image
+ *
+ *	@retval none
+ */
+void Display_DrawPackedIMG(struct SSD1351 *display, uint8_t x, uint8_t y, const uint8_t img[])
+{
+	struct Display_Unpack unpack;
+	uint16_t line[DISPLAY_WIDTH];
+	uint8_t imgW = img[0];
+	uint8_t imgH = img[1];
+	uint8_t width, height, skip, j;
+	struct Display_Rect box;
+
+	if(!Display_ClipBox(display, x, y, imgW, imgH, &box)) return;	/* Clip the image once */
+
+	DISPLAY_RECORD(display, DISPLAY_OP_PACKED, x, y, 0, 0, img, box.x0, box.y0, box.x1, box.y1);
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	memset(&unpack, 0, sizeof(unpack));
+	unpack.src = img + DISPLAY_PACK_HEADER;
+
+	for(j = box.y0 - (y + display->originY); j; j--)	/* Rows above the clip */
+	{
+		Display_UnpackRow(&unpack, line, 0, 0, imgW);
+	}
+
+	skip = box.x0 - (x + display->originX);
+	x = box.x0;
+	y = box.y0;
+	width = box.x1 - box.x0 + 1;
+	height = box.y1 - box.y0 + 1;
+
+#if DISPLAY_HAS_BUFFER
+	for(j = 0; j < height; j++)
+	{
+		Display_UnpackRow(&unpack, line, skip, width, imgW);
+
+#if DISPLAY_INDEXED
+		Display_StoreRow(display, x, y + j, width, line);
+#else
+		uint16_t *row = &((uint16_t *)&display->frameBuffer)[DISPLAY_WIDTH * (y + j) + x];
+
+		if(display->drawMode == DISPLAY_DRAW_MODE_BLEND)
+		{
+			Display_BlendLine(row, line, width, DISPLAY_ALPHA32(display->alpha));
+		}
+		else
+		{
+			memcpy(row, line, width * 2);
+		}
+#endif
+	}
+#else
+	uint8_t rows;
+
+#if defined(DISPLAY_USE_BANDS)
+	if(display->bandRows)	/* Replaying the display list: the rows inside the band */
+	{
+		for(j = 0; j < height && y + j < display->bandY + display->bandRows; j++)
+		{
+			Display_UnpackRow(&unpack, line, skip, width, imgW);
+
+			if(y + j >= display->bandY) memcpy(&display->band[DISPLAY_WIDTH * (y + j - display->bandY) + x], line, width * 2);
+		}
+
+		return;
+	}
+#endif
+
+	for(j = 0; j < height; )	/* One zone, or two when the image crosses the RAM wrap */
+	{
+		rows = Display_ZoneRows(display, y + j, height - j);
+
+		Display_SetDrawZone(display, x, y + j, width, rows);
+
+		Display_Begin(display);
+
+		DISPLAY_STAT_ADD(display, dataBytes, (uint32_t)width * rows * 2);
+
+		for(; rows; rows--, j++)
+		{
+			Display_UnpackRow(&unpack, line, skip, width, imgW);
+
+			display->transport->writePixels(display, line, width);
+		}
+
+		Display_End(display);
+	}
+#endif
+}
+
+
+/*
+ *	@brief	Draw an RGB565 image with one alpha byte per pixel
+ *		Pixels are blended into the frame buffer by their own alpha, scaled by the global alpha
+ *		in BLEND mode. Without an RGB565 frame buffer the pixels with alpha >= 128 are drawn
+ *		opaque, as runs through Display_BlitIMG
+ *
+ *	@note	Pixels are stored MSB first, 2 bytes each. With a palette frame buffer they are palette indices
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Image top left corner x coordinate
+ *	@param	Image top left corner y coordinate
+ *	@param	Image width
+ *	@param	Image height
+ *	@param	Image pixels, row by row
+ *	@param	Alpha of each pixel (0 - transparent .. 255 - opaque), row by row
+ *
+ *	@retval none
+ */
+void Display_DrawIMGAlpha(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t imgW, uint8_t imgH, const uint8_t img[], const uint8_t alpha[])
 {
-	uint8_t i, j;
+	uint8_t width, height, skipX, skipY, i, j;
+	struct Display_Rect box;
 
-	if(x > DISPLAY_WIDTH || y > DISPLAY_HEIGHT) return; /*checking for compliance with restrictions*/
+	if(!Display_ClipBox(display, x, y, imgW, imgH, &box)) return;	/* Clip the image once */
 
-	if((asciiChr >= 0x20) && (asciiChr <= 0x7f)) /*ASCII table offset selection*/
+	skipX = box.x0 - (x + display->originX);
+	skipY = box.y0 - (y + display->originY);
+	width = box.x1 - box.x0 + 1;
+	height = box.y1 - box.y0 + 1;
+
+	img += ((uint16_t)skipY * imgW + skipX) * 2;	/* First visible pixel */
+	alpha += (uint16_t)skipY * imgW + skipX;
+
+#if DISPLAY_HAS_BLEND
+	uint16_t *row = &((uint16_t *)&display->frameBuffer)[DISPLAY_WIDTH * box.y0 + box.x0];
+	uint16_t scale = display->drawMode == DISPLAY_DRAW_MODE_BLEND ? display->alpha : 255;
+	uint16_t color;
+	uint8_t weight;
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	for(j = 0; j < height; j++, row += DISPLAY_WIDTH, img += imgW * 2, alpha += imgW)
 	{
-		asciiChr -= 32;
+		for(i = 0; i < width; i++)
+		{
+			weight = DISPLAY_ALPHA32(alpha[i] * scale / 255);
+
+			if(weight == 0) continue;
+
+			color = ((uint16_t)img[i * 2] << 8) | img[i * 2 + 1];
+			row[i] = weight == 32 ? color : Display_Blend(row[i], color, weight);
+		}
 	}
-	else if(asciiChr >= 0xc0)
+#else
+	uint8_t length;
+
+	for(j = 0; j < height; j++, img += imgW * 2, alpha += imgW)
 	{
-		asciiChr -= 96;
+		for(i = 0; i < width; i += length)
+		{
+			for(length = 0; i + length < width && alpha[i + length] >= 128; length++);	/* Run of opaque pixels */
+
+			if(length == 0)
+			{
+				length = 1;
+				continue;
+			}
+
+			Display_BlitIMG(display, x + skipX + i, y + skipY + j, length, 1, &img[i * 2], imgW * 2, 0, 0);
+		}
 	}
-	else
+#endif
+}
+
+
+/*
+ *	@brief	Draw the draw color through a coverage mask, e.g. an anti-aliased glyph
+ *		Mask values are blended like the alpha of Display_DrawIMGAlpha. Without an RGB565
+ *		frame buffer the pixels with coverage >= 128 are drawn as runs through Display_DrawBox
+ *
+ *	@note	The color is set by the currentDrawColor value
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Mask top left corner x coordinate
+ *	@param	Mask top left corner y coordinate
+ *	@param	Mask width
+ *	@param	Mask height
+ *	@param	Coverage of each pixel (0 - none .. 255 - full), row by row
+ *
+ *	@retval none
+ */
+void Display_DrawAlphaMask(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t maskW, uint8_t maskH, const uint8_t mask[])
+{
+	uint8_t width, height, skipX, skipY, i, j;
+	struct Display_Rect box;
+
+	if(!Display_ClipBox(display, x, y, maskW, maskH, &box)) return;	/* Clip the mask once */
+
+	skipX = box.x0 - (x + display->originX);
+	skipY = box.y0 - (y + display->originY);
+	width = box.x1 - box.x0 + 1;
+	height = box.y1 - box.y0 + 1;
+
+	mask += (uint16_t)skipY * maskW + skipX;	/* First visible pixel */
+
+#if DISPLAY_HAS_BLEND
+	uint16_t *row = &((uint16_t *)&display->frameBuffer)[DISPLAY_WIDTH * box.y0 + box.x0];
+	uint16_t scale = display->drawMode == DISPLAY_DRAW_MODE_BLEND ? display->alpha : 255;
+	uint8_t weight;
+
+	Display_MarkDirty(display, box.x0, box.y0, box.x1, box.y1);
+
+	for(j = 0; j < height; j++, row += DISPLAY_WIDTH, mask += maskW)
 	{
-		asciiChr = 85;
+		for(i = 0; i < width; i++)
+		{
+			weight = DISPLAY_ALPHA32(mask[i] * scale / 255);
+
+			if(weight) row[i] = Display_Blend(row[i], display->currentDrawColor, weight);
+		}
 	}
+#else
+	uint8_t length;
 
-	for(i = 0; i < 5; i++) /* Pixel-by-pixel image of the symbol on the display */
+	for(j = 0; j < height; j++, mask += maskW)
 	{
-		for(j = 0; j < 8; j++)
+		for(i = 0; i < width; i += length)
 		{
-			if(font_5x8[asciiChr * 5 + i] & (1 << j))
-			{
-				Display_DrawPixel(display, x + i, y + j, display->currentDrawColor);
-			}
-			else if(!(font_5x8[asciiChr * 5 + i] & (1 << j)) && display->drawMode == DISPLAY_DRAW_MODE_OVERRIDE)
+			for(length = 0; i + length < width && mask[i + length] >= 128; length++);	/* Run of covered pixels */
+
+			if(length == 0)
 			{
-				Display_DrawPixel(display, x + i, y + j, display->currentBackColor);
+				length = 1;
+				continue;
 			}
+
+			Display_DrawBox(display, x + skipX + i, y + skipY + j, length, 1);
 		}
 	}
-
+#endif
 }
 
 
+#if defined(DISPLAY_USE_SPRITES)
+
 /*
- *	@brief	Set display cursor.
- *		When calling the Display_drawAsciiChar() function, 
- *		the character will be displayed at the specified coordinates
- * 
- *	@param	Ptr to the SSD1351 struct
- *	@param	Cursor x coordinate
- *	@param  Cursor y coordinate
- * 
- *  @retval	none
+ *	@brief	Screen pixels a sprite covers
+ *
+ *	@param	Sprite
+ *	@param	Covered rectangle
+ *
+ *	@retval	1 - some of the sprite is on the screen, 0 - none
  */
-void Display_SetCursor(struct SSD1351 *display, uint8_t x, uint8_t y)
+static uint8_t Display_SpriteBox( const struct Display_Sprite * sprite, struct Display_Rect * box )
 {
-	if(x > DISPLAY_WIDTH || y > DISPLAY_HEIGHT) return;
+	int16_t x1 = sprite->x + sprite->width - 1;
+	int16_t y1 = sprite->y + sprite->height - 1;
 
-	display->cursorX = x;
-	display->cursorY = y;
-}
+	if(!sprite->used || !sprite->visible || sprite->width == 0 || sprite->height == 0) return 0;
 
-#define DISPLAY_CURSOR_OFFSET_X	(uint8_t)(DISPLAY_FONT_WIDTH + 1)
-#define DISPLAY_CURSOR_OFFSET_Y	(uint8_t)(DISPLAY_FONT_HEIGHT + 1)
+	if(x1 < 0 || y1 < 0 || sprite->x >= DISPLAY_WIDTH || sprite->y >= DISPLAY_HEIGHT) return 0;
+
+	*box = (struct Display_Rect){ sprite->x < 0 ? 0 : sprite->x, sprite->y < 0 ? 0 : sprite->y,
+			x1 < DISPLAY_WIDTH ? x1 : DISPLAY_WIDTH - 1, y1 < DISPLAY_HEIGHT ? y1 : DISPLAY_HEIGHT - 1 };
+
+	return 1;
+}
 
 
 /*
- *	@brief	Displays a line starting from the current cursor position
- * 
- *	@param	Ptr to the SSD1351 struct
- *	@param	String
- * 
+ *	@brief	Add a rectangle to the ones Display_SpritesUpd draws again
+ *		Overlapping rectangles are joined, so no pixel is drawn twice
+ *
+ *	@param	Rectangles
+ *	@param	Their number
+ *	@param	New rectangle
+ *
  *	@retval none
  */
-void Display_PrintString(struct SSD1351 *display, char str[])
+static void Display_SpriteArea( struct Display_Rect * rects, uint8_t * count, struct Display_Rect rect )
 {
 	uint8_t i = 0;
 
-	if(display->cursorX > DISPLAY_WIDTH || display->cursorY > DISPLAY_HEIGHT) return;
-
-	while(str[i] != 0 && display->cursorX < DISPLAY_WIDTH)
+	while(i < *count)
 	{
-		Display_DrawAsciiChar(display, display->cursorX, display->cursorY, str[i]);
-		display->cursorX += DISPLAY_CURSOR_OFFSET_X;	/* Move the cursor to the right by one */
-		i++;
+		if(rect.x0 > rects[i].x1 || rect.x1 < rects[i].x0 || rect.y0 > rects[i].y1 || rect.y1 < rects[i].y0)
+		{
+			i++;
+			continue;
+		}
+
+		if(rects[i].x0 < rect.x0) rect.x0 = rects[i].x0;	/* Take the overlapping one in and look again */
+		if(rects[i].y0 < rect.y0) rect.y0 = rects[i].y0;
+		if(rects[i].x1 > rect.x1) rect.x1 = rects[i].x1;
+		if(rects[i].y1 > rect.y1) rect.y1 = rects[i].y1;
+
+		rects[i] = rects[--(*count)];
+		i = 0;
 	}
 
+	rects[(*count)++] = rect;
 }
 
 
 /*
- *	@brief	Print a signed integer of 32 bits starting from the current cursor position
- *	
+ *	@brief	Set the clip rectangle and origin the compositor draws with
+ *
  *	@param	Ptr to the SSD1351 struct
- *	@param	Number
- * 
- *	@retval	none
+ *	@param	Clip rectangle
+ *	@param	Origin x
+ *	@param	Origin y
+ *
+ *	@retval none
  */
-void Display_PrintNum(struct SSD1351 *display, int32_t num)
+static void Display_SpriteView( struct SSD1351 * display, const struct Display_Rect * clip, int16_t x, int16_t y )
 {
-	uint8_t numLength = 0;
-	int32_t numBuff;
-	uint8_t numChar;
+	display->clip = *clip;
+	display->originX = x;
+	display->originY = y;
 
-	if(num == 0)	/* Print zero and exit the function if the number is 0 */
-	{
-		Display_DrawAsciiChar(display, display->cursorX, display->cursorY, '0');
-		display->cursorX += DISPLAY_CURSOR_OFFSET_X;
-		return;
-	}
+#if defined(DISPLAY_USE_BANDS)
+	Display_ListView(display);
+#endif
+}
 
-	if(num < 0)	/* Print a minus sign at the beginning of the line if the number is less than zero */
-	{
-		Display_DrawAsciiChar(display, display->cursorX, display->cursorY, '-');
-		display->cursorX += DISPLAY_CURSOR_OFFSET_X;
 
-		num = num * -1;
-	}
+/*
+ *	@brief	Take a sprite from the pool
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Screen x of the top left corner
+ *	@param	Screen y of the top left corner
+ *	@param	Image width
+ *	@param	Image height
+ *	@param	Image: RGB565 pixels (2 bytes each, MSB first) or XBM rows, must stay valid while the sprite is used
+ *	@param	DISPLAY_SPRITE_IMG, DISPLAY_SPRITE_IMG_KEY or DISPLAY_SPRITE_XBM
+ *	@param	Transparent color (IMG_KEY) or color of the set bits (XBM)
+ *
+ *	@retval	Sprite number, DISPLAY_SPRITE_NONE when the pool is full
+ */
+uint8_t Display_SpriteAdd(struct SSD1351 *display, int16_t x, int16_t y, uint8_t width, uint8_t height, const uint8_t image[], uint8_t format, uint16_t color)
+{
+	struct Display_Sprite *sprite;
+	uint8_t i;
 
-	numBuff = num;	/* Save the number in the buffer */
+	for(i = 0; i < DISPLAY_SPRITES && display->sprites[i].used; i++);
 
-	while(numBuff)	/* Get num length */
-	{
-		numLength++;
-		numBuff /= 10;
-	}
+	if(i == DISPLAY_SPRITES) return DISPLAY_SPRITE_NONE;
 
-	while((numLength--) && display->cursorX < DISPLAY_WIDTH) /* Print the number sign by sign */
-	{
-		numBuff = (num / powl(10, numLength));
-		numChar = numBuff + '0';
-		num -= numBuff * powl(10, numLength);
+	sprite = &display->sprites[i];
 
-		Display_DrawAsciiChar(display, display->cursorX, display->cursorY, numChar);
+	sprite->image = image;	/* shown is kept: a removed sprite may still have to be cleared */
+	sprite->x = x;
+	sprite->y = y;
+	sprite->width = width;
+	sprite->height = height;
+	sprite->format = format;
+	sprite->color = color;
+	sprite->z = 0;
+	sprite->used = 1;
+	sprite->visible = 1;
+	sprite->changed = 1;
 
-		display->cursorX += DISPLAY_CURSOR_OFFSET_X;	/* Move the cursor to the right by one */
-	}
+	return i;
 }
 
 
 /*
- *	@brief	Implementation of the printf function for displaying formatted text on the display
- * 
- *	@param	Ptr to the display struct
- *	@param	Format
- *	@param	Arg list
- * 
- *	@retval	none
+ *	@brief	Return a sprite to the pool, Display_SpritesUpd clears it from the screen
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Sprite number
+ *
+ *	@retval none
  */
-void Display_Printf(struct SSD1351 *display, const char *format, ...)
+void Display_SpriteRemove(struct SSD1351 *display, uint8_t sprite)
 {
-	//TODO
+	if(sprite >= DISPLAY_SPRITES) return;
+
+	display->sprites[sprite].used = 0;
+	display->sprites[sprite].changed = 1;
 }
 
 
 /*
- *	@brief	Draw a frame with the specified size at the specified coordinates
- * 
- *	@note	The border color is set by the currentDrawColor value, 
- *		call the Display_setDrawColor function to change it
- * 
- *		If the value of xbmDrawMode > 0, 
- *		then the frame will completely block the previously drawn image
- * 
+ *	@brief	Move a sprite
+ *
  *	@param	Ptr to the SSD1351 struct
- *	@param	Frame top left corner x coordinate
- *	@param	Frame top left corner y coordinate
- *	@param	Frame width
- *	@param	Frame height
- *	
- *	@retval	none
+ *	@param	Sprite number
+ *	@param	Screen x of the top left corner
+ *	@param	Screen y of the top left corner
+ *
+ *	@retval none
  */
-void Display_DrawFrame(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+void Display_SpriteMove(struct SSD1351 *display, uint8_t sprite, int16_t x, int16_t y)
 {
-	uint8_t i, j;
+	struct Display_Sprite *entry;
 
-	for(i = 0; i < height; i++)
-	{
-		Display_DrawPixel(display, x, y + i, display->currentDrawColor);
-	}
+	if(sprite >= DISPLAY_SPRITES) return;
 
-	for(i = 1; i < width - 1; i++)
-	{
-		Display_DrawPixel(display, x + i, y, display->currentDrawColor);
+	entry = &display->sprites[sprite];
 
-		if(display->drawMode == DISPLAY_DRAW_MODE_OVERRIDE)
-		{
-			for(j = 1; j < height; j++)
-			{
-				Display_DrawPixel(display, x + i, y + j, display->currentBackColor);
-			}
-		}
+	if(entry->x == x && entry->y == y) return;
 
-		Display_DrawPixel(display, x + i, y + height - 1, display->currentDrawColor);
+	entry->x = x;
+	entry->y = y;
+	entry->changed = 1;
+}
 
-	}
 
-	for(i = 0; i < height; i++)
-	{
-		Display_DrawPixel(display, x + width - 1, y + i, display->currentDrawColor);
-	}
+/*
+ *	@brief	Show or hide a sprite
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Sprite number
+ *	@param	1 - show, 0 - hide
+ *
+ *	@retval none
+ */
+void Display_SpriteShow(struct SSD1351 *display, uint8_t sprite, uint8_t visible)
+{
+	if(sprite >= DISPLAY_SPRITES || display->sprites[sprite].visible == !!visible) return;
+
+	display->sprites[sprite].visible = !!visible;
+	display->sprites[sprite].changed = 1;
 }
 
 
 /*
- *	@brief	Draw a rectangle of the specified dimensions at the specified coordinates
- *	
- *	@note	The box color is set by the currentDrawColor value, 
- *		call the Display_setDrawColor function to change it
- * 
-  *	@param	Ptr to the SSD1351 struct
- *	@param	Box top left corner x coordinate
- *	@param	Box top left corner y coordinate
- *	@param	Box width
- *	@param	Box height
- * 
+ *	@brief	Change the image of a sprite, e.g. the next animation frame
+ *		The new image has the size and format of the old one
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Sprite number
+ *	@param	Image
+ *
  *	@retval none
  */
-void Display_DrawBox(struct SSD1351 *display, uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+void Display_SpriteSetImage(struct SSD1351 *display, uint8_t sprite, const uint8_t image[])
 {
-	uint8_t i, j;
+	if(sprite >= DISPLAY_SPRITES) return;
 
-	if(x > DISPLAY_WIDTH || y > DISPLAY_HEIGHT) return;
+	display->sprites[sprite].image = image;
+	display->sprites[sprite].changed = 1;
+}
 
-	for(i = 0; i < width; i++)
-	{
-		for(j = 0; j < height; j++)
-		{
-			Display_DrawPixel(display, x + i, y + j, display->currentDrawColor);
-		}
-	}
+
+/*
+ *	@brief	Set the stacking order of a sprite
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *	@param	Sprite number
+ *	@param	z, sprites with higher z are drawn over the others
+ *
+ *	@retval none
+ */
+void Display_SpriteSetZ(struct SSD1351 *display, uint8_t sprite, uint8_t z)
+{
+	if(sprite >= DISPLAY_SPRITES || display->sprites[sprite].z == z) return;
+
+	display->sprites[sprite].z = z;
+	display->sprites[sprite].changed = 1;
 }
 
 
 /*
- *	@brief	Draw a monochrome bitmap (XBM)
- * 
- *	@note	The XBM color is set by the currentDrawColor value, 
- *		call the Display_setDrawColor function to change it
- * 
+ *	@brief	Set the function that draws the background under the sprites
+ *		It is called with the clip rectangle set to the rectangle and the origin at (0, 0),
+ *		so it may draw the whole background and only that part is changed
+ *
  *	@param	Ptr to the SSD1351 struct
- *	@param	XBM top left corner x coordinate
- *	@param	XBM top left corner y coordinate
- *	@param	XBM width
- *	@param	XBM height	
- *	@param	XBM array pointer
- * 
+ *	@param	Background function, NULL - fill with currentBackColor
+ *
  *	@retval none
  */
-void Display_DrawXBM(struct SSD1351 *display, uint8_t xbmStartx, uint8_t xbmStarty, uint8_t xbmWidth, uint8_t xbmHeight, uint8_t xbm[])
+void Display_SetSpriteBackground(struct SSD1351 *display, void (*background)(struct SSD1351 *display, const struct Display_Rect *rect))
 {
-	uint8_t xbmArrayLength;
-	uint8_t i;
-	uint8_t j;
-	int8_t k;
+	display->spriteBackground = background;
+}
 
-	xbmArrayLength = (xbmWidth / 8) + 1;
-	if((xbmWidth % 8) == 0) xbmArrayLength = (xbmWidth / 8);
 
-	for(i = 0; i < xbmHeight; i++)
+/*
+ *	@brief	Bring the sprites on the screen up to date
+ *		The rectangles the changed sprites covered before and cover now are joined where they
+ *		overlap. Each of them gets the background and then every sprite over it in z order,
+ *		clipped to the rectangle, so only those pixels change. With an update buffer only they
+ *		are sent by the Display_Upd at the end
+ *
+ *	@note	The draw color, back color, mode, clip and origin are restored afterwards
+ *
+ *	@param	Ptr to the SSD1351 struct
+ *
+ *	@retval none
+ */
+void Display_SpritesUpd(struct SSD1351 *display)
+{
+	struct Display_Rect rects[2 * DISPLAY_SPRITES], clip = display->clip, box;
+	struct Display_Sprite *sprite;
+	int16_t originX = display->originX, originY = display->originY;
+	uint16_t drawColor = display->currentDrawColor;
+	uint8_t drawMode = display->drawMode;
+	uint8_t order[DISPLAY_SPRITES], count = 0, visible = 0, i, j, k;
+
+	for(i = 0; i < DISPLAY_SPRITES; i++)
+	{
+		sprite = &display->sprites[i];
+
+		if(sprite->used && sprite->visible)	/* Drawing order: by z, then by pool order */
+		{
+			for(k = visible++; k > 0 && display->sprites[order[k - 1]].z > sprite->z; k--) order[k] = order[k - 1];
+
+			order[k] = i;
+		}
+
+		if(!sprite->changed) continue;
+
+		if(sprite->shown.x0 <= sprite->shown.x1) Display_SpriteArea(rects, &count, sprite->shown);	/* Where it was */
+		if(Display_SpriteBox(sprite, &box)) Display_SpriteArea(rects, &count, box);			/* Where it is */
+	}
+
+	for(j = 0; j < count; j++)
 	{
-		k = 0;
-		for(j = 0; j < xbmWidth; j++)
+		Display_SpriteView(display, &rects[j], 0, 0);
+
+		if(display->spriteBackground)
+		{
+			display->spriteBackground(display, &rects[j]);
+		}
+		else
+		{
+			Display_SetDrawMode(display, DISPLAY_DRAW_MODE_OVERRIDE);
+			Display_SetDrawColor(display, display->currentBackColor);
+			Display_DrawBox(display, rects[j].x0, rects[j].y0, rects[j].x1 - rects[j].x0 + 1, rects[j].y1 - rects[j].y0 + 1);
+		}
+
+		for(k = 0; k < visible; k++)
 		{
-			if(k == 8) k = 0;
+			sprite = &display->sprites[order[k]];
+
+			if(!Display_SpriteBox(sprite, &box) || box.x0 > rects[j].x1 || box.x1 < rects[j].x0 ||
+				box.y0 > rects[j].y1 || box.y1 < rects[j].y0) continue;
 
-			if(xbm[(j / 8) + (i * xbmArrayLength)] & (1 << k))
+			Display_SpriteView(display, &rects[j], sprite->x, sprite->y);
+
+			switch(sprite->format)
 			{
-				Display_DrawPixel(display, xbmStartx + j, xbmStarty + i, display->currentDrawColor);
+			case DISPLAY_SPRITE_IMG:
+				Display_SetDrawMode(display, DISPLAY_DRAW_MODE_OVERRIDE);
+				Display_DrawIMG(display, 0, 0, sprite->width, sprite->height, (uint8_t *)sprite->image);
+				break;
+
+			case DISPLAY_SPRITE_IMG_KEY:
+				Display_SetDrawMode(display, DISPLAY_DRAW_MODE_OVERRIDE);
+				Display_DrawIMGKey(display, 0, 0, sprite->width, sprite->height, sprite->image, sprite->color);
+				break;
+
+			case DISPLAY_SPRITE_XBM:
+				Display_SetDrawMode(display, DISPLAY_DRAW_MODE_COMPOSE);
+				Display_SetDrawColor(display, sprite->color);
+				Display_DrawXBM(display, 0, 0, sprite->width, sprite->height, (uint8_t *)sprite->image);
+				break;
 			}
-
-			k++;
 		}
 	}
-}
 
+	for(i = 0; i < DISPLAY_SPRITES; i++)
+	{
+		sprite = &display->sprites[i];
 
-void Display_DrawIMG(struct SSD1351 *display, uint8_t imgStartx, uint8_t imgStarty, uint8_t imgW, uint8_t imgH, uint8_t img[])
-{
+		if(!sprite->changed) continue;
 
+		if(!Display_SpriteBox(sprite, &sprite->shown)) sprite->shown = (struct Display_Rect){ 1, 1, 0, 0 };
+
+		sprite->changed = 0;
+	}
+
+	if(count == 0) return;
+
+	Display_SetDrawMode(display, drawMode);
+	Display_SetDrawColor(display, drawColor);
+	display->clip = clip;
+
+	Display_SetOrigin(display, originX, originY);	/* Records the restored view with bands */
+
+#if DISPLAY_HAS_UPD
+	Display_Upd(display);
+#endif
 }
+
+#endif /* DISPLAY_USE_SPRITES */